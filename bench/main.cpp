@@ -0,0 +1,166 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "benchmark.h"
+
+using namespace Doppio;
+
+namespace
+{
+
+void usage()
+{
+    fprintf(stderr,
+            "usage: doppio_benchmark [options]\n"
+            "  -t SECONDS     minimum time per measurement (0.2)\n"
+            "  -c NAME        run only the default corpus NAME\n"
+            "  -o FILE        write the JSON to FILE instead of stdout\n"
+            "A custom corpus replaces the default corpora if any of these\n"
+            "is given:\n"
+            "  --depth N --width N --literals RATIO --identifiers N\n"
+            "  --assignments RATIO --formulas N --seed N\n");
+}
+
+} /* anonymous namespace */
+
+int main(int argc, char** argv)
+{
+    double seconds = 0.2;
+    const char* only = NULL;
+    const char* output = NULL;
+    bool custom = false;
+    Benchmark::Corpus corpus;
+    corpus.name = "custom";
+    corpus.formulas = 10000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* option = argv[i];
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 2;
+        }
+        const char* value = argv[++i];
+        if (strcmp(option, "-t") == 0)
+        {
+            seconds = atof(value);
+        }
+        else if (strcmp(option, "-c") == 0)
+        {
+            only = value;
+        }
+        else if (strcmp(option, "-o") == 0)
+        {
+            output = value;
+        }
+        else
+        {
+            custom = true;
+            if (strcmp(option, "--depth") == 0)
+            {
+                corpus.options.depth = atoi(value);
+            }
+            else if (strcmp(option, "--width") == 0)
+            {
+                corpus.options.width = atoi(value);
+            }
+            else if (strcmp(option, "--literals") == 0)
+            {
+                corpus.options.literalRatio = atof(value);
+            }
+            else if (strcmp(option, "--identifiers") == 0)
+            {
+                corpus.options.identifierCount = atoi(value);
+            }
+            else if (strcmp(option, "--assignments") == 0)
+            {
+                corpus.options.assignmentRatio = atof(value);
+            }
+            else if (strcmp(option, "--formulas") == 0)
+            {
+                corpus.formulas = atoi(value);
+            }
+            else if (strcmp(option, "--seed") == 0)
+            {
+                corpus.options.seed = (uint32_t) strtoul(value, NULL, 10);
+            }
+            else
+            {
+                usage();
+                return 2;
+            }
+        }
+    }
+
+    std::vector<Benchmark::Corpus> corpora;
+    if (custom)
+    {
+        if (corpus.options.depth < 0 || corpus.options.width < 1
+                || corpus.options.identifierCount < 1 || corpus.formulas < 1)
+        {
+            usage();
+            return 2;
+        }
+        corpora.push_back(corpus);
+    }
+    else
+    {
+        std::vector<Benchmark::Corpus> defaults = Benchmark::DefaultCorpora();
+        for (size_t i = 0; i < defaults.size(); i++)
+        {
+            if (only == NULL || strcmp(only, defaults[i].name) == 0)
+            {
+                corpora.push_back(defaults[i]);
+            }
+        }
+        if (corpora.empty())
+        {
+            fprintf(stderr, "doppio_benchmark: no corpus named %s\n", only);
+            return 2;
+        }
+    }
+
+    FILE* out = stdout;
+    if (output)
+    {
+        out = fopen(output, "w");
+        if (out == NULL)
+        {
+            perror(output);
+            return 1;
+        }
+    }
+
+    Benchmark benchmark(seconds);
+    for (size_t i = 0; i < corpora.size(); i++)
+    {
+        fprintf(stderr, "%s...\n", corpora[i].name);
+        benchmark.run(corpora[i]);
+    }
+    benchmark.writeJson(out);
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+    return 0;
+}
@@ -1,276 +1,429 @@
-/*
- * Licensed to the Apache Software Foundation (ASF) under one
- * or more contributor license agreements.  See the NOTICE file
- * distributed with this work for additional information
- * regarding copyright ownership.  The ASF licenses this file
- * to you under the Apache License, Version 2.0 (the
- * "License"); you may not use this file except in compliance
- * with the License.  You may obtain a copy of the License at
- *
- * http://www.apache.org/licenses/LICENSE-2.0
- *
- * Unless required by applicable law or agreed to in writing,
- * software distributed under the License is distributed on an
- * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
- * KIND, either express or implied.  See the License for the
- * specific language governing permissions and limitations
- * under the License.
- */
-
-#ifndef DOPPIO_AST_H_
-#define DOPPIO_AST_H_
-
-#include <vector>
-#include <string>
-#include <cmath>
-#include "token.h"
-
-namespace Doppio
-{
-
-class AstNode
-{
-public:
-    virtual ~AstNode()
-    {
-    }
-
-protected:
-    AstNode()
-    {
-    }
-};
-
-/* E x p r e s s i o n s */
-class Expression: public AstNode
-{
-public:
-    Expression()
-    {
-    }
-
-    virtual bool isConstant() const
-    {
-        return false;
-    }
-};
-
-class AssignmentExpression: public Expression
-{
-private:
-    Token::Type _operation;
-    Expression* _target;
-    Expression* _value;
-
-public:
-    AssignmentExpression(Token::Type operation, Expression* target,
-            Expression* value) :
-            _operation(operation), _target(target), _value(value)
-    {
-    }
-
-    Expression* target() const
-    {
-        return _target;
-    }
-    Expression* value() const
-    {
-        return _value;
-    }
-};
-
-class UnaryOperationExpression: public Expression
-{
-private:
-    Token::Type _operation;
-    Expression* _expression;
-
-public:
-    UnaryOperationExpression(Token::Type operation, Expression* expression) :
-            _operation(operation), _expression(expression)
-    {
-    }
-
-    Token::Type operation() const
-    {
-        return _operation;
-    }
-    Expression* expression() const
-    {
-        return _expression;
-    }
-};
-
-class BinaryOperationExpression: public Expression
-{
-private:
-    Token::Type _operation;
-    Expression* _left;
-    Expression* _right;
-
-public:
-    BinaryOperationExpression(Token::Type operation, Expression* left,
-            Expression* right) :
-            _operation(operation), _left(left), _right(right)
-    {
-    }
-
-    Token::Type operation() const
-    {
-        return _operation;
-    }
-    Expression* left() const
-    {
-        return _left;
-    }
-    Expression* right() const
-    {
-        return _right;
-    }
-};
-
-class FunctionExpression: public Expression
-{
-private:
-    Expression* _identifier;
-    std::vector<Expression*> _arguments;
-
-public:
-    FunctionExpression(Expression* identifier,
-            std::vector<Expression*> arguments) :
-            _identifier(identifier), _arguments(arguments)
-    {
-    }
-};
-
-class Identifier: public Expression
-{
-private:
-    std::string _value;
-
-public:
-    Identifier(std::string value) :
-            _value(value)
-    {
-    }
-};
-
-class Number: public Expression
-{
-private:
-    Token::Type _type;
-    union
-    {
-        double _real;
-        long _integer;
-    };
-
-public:
-    Number(double value) :
-            _type(Token::NUMBER_FLOAT), _real(value)
-    {
-    }
-
-    Number(long value) :
-            _type(Token::NUMBER_INTEGER), _integer(value)
-    {
-    }
-
-    Token::Type type() const
-    {
-        return _type;
-    }
-
-    bool isConstant() const
-    {
-        return true;
-    }
-
-    double real() const
-    {
-        return _type == Token::NUMBER_FLOAT ? _real : (double) _integer;
-    }
-
-    long integer() const
-    {
-        return _type == Token::NUMBER_INTEGER ? _integer : (long) _real;
-    }
-
-    friend Number* operator+(const Number &c1, const Number &c2)
-    {
-        if (c1.type() == Token::NUMBER_INTEGER
-                && c2.type() == Token::NUMBER_INTEGER)
-        {
-            return new Number(c1.integer() + c2.integer());
-        }
-        return new Number(c1.real() + c2.real());
-    }
-
-    friend Number* operator-(const Number &c1, const Number &c2)
-    {
-        if (c1.type() == Token::NUMBER_INTEGER
-                && c2.type() == Token::NUMBER_INTEGER)
-        {
-            return new Number(c1.integer() - c2.integer());
-        }
-        return new Number(c1.real() - c2.real());
-    }
-
-    friend Number* operator*(const Number &c1, const Number &c2)
-    {
-        if (c1.type() == Token::NUMBER_INTEGER
-                && c2.type() == Token::NUMBER_INTEGER)
-        {
-            return new Number(c1.integer() * c2.integer());
-        }
-        return new Number(c1.real() * c2.real());
-    }
-
-    friend Number* operator/(const Number &c1, const Number &c2)
-    {
-        return new Number(c1.real() / c2.real());
-    }
-
-    friend Number* operator%(const Number &c1, const Number &c2)
-    {
-        if (c1.type() == Token::NUMBER_INTEGER
-                && c2.type() == Token::NUMBER_INTEGER)
-        {
-            return new Number(c1.integer() % c2.integer());
-        }
-        double x = c1.real();
-        double n = c2.real();
-        return new Number(x - n * floor(x / n));
-    }
-
-    friend Number* operator^(const Number &c1, const Number &c2)
-    {
-        return new Number(pow(c1.real(), c2.real()));
-    }
-};
-
-/* S t a t e m e n t s */
-class Statement: public AstNode
-{
-public:
-    virtual bool IsEmpty() const
-    {
-        return false;
-    }
-};
-
-class ExpressionStatement: public Statement
-{
-private:
-    Expression *_expression;
-
-public:
-    Expression* expression() const
-    {
-        return _expression;
-    }
-};
-
-} /* Doppio namespace */
-
-#endif /* DOPPIO_AST_H_ */
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_AST_H_
+#define DOPPIO_AST_H_
+
+#include "symbols.h"
+#include "token.h"
+#include "value.h"
+#include "zone.h"
+
+namespace Doppio
+{
+
+#define EXPRESSION_NODE_LIST(V)                                           \
+    V(AssignmentExpression)                                               \
+    V(UnaryOperationExpression)                                           \
+    V(BinaryOperationExpression)                                          \
+    V(FunctionExpression)                                                 \
+    V(Identifier)                                                         \
+    V(Number)
+
+#define STATEMENT_NODE_LIST(V)                                            \
+    V(ExpressionStatement)
+
+#define AST_NODE_LIST(V)                                                  \
+    EXPRESSION_NODE_LIST(V)                                               \
+    STATEMENT_NODE_LIST(V)
+
+#define DECLARE_NODE_CLASS(type) class type;
+AST_NODE_LIST(DECLARE_NODE_CLASS)
+#undef DECLARE_NODE_CLASS
+
+// AST nodes are allocated in the Zone of the Parser that created them and
+// are freed together with it. Nodes have no virtual functions; the class
+// of a node is told by its node type.
+class AstNode: public ZoneObject
+{
+public:
+#define DECLARE_TYPE_ENUM(type) k##type,
+    enum NodeType
+    {
+        AST_NODE_LIST(DECLARE_TYPE_ENUM)
+    };
+#undef DECLARE_TYPE_ENUM
+
+#define COUNT_NODE_TYPE(type) + 1
+    static const int kNodeTypeCount = 0 AST_NODE_LIST(COUNT_NODE_TYPE);
+#undef COUNT_NODE_TYPE
+
+    NodeType nodeType() const
+    {
+        return _nodeType;
+    }
+
+protected:
+    explicit AstNode(NodeType nodeType) :
+            _nodeType(nodeType)
+    {
+    }
+
+private:
+    NodeType _nodeType;
+};
+
+/* E x p r e s s i o n s */
+class Expression: public AstNode
+{
+private:
+    StaticType _staticType;
+
+protected:
+    explicit Expression(NodeType nodeType) :
+            AstNode(nodeType), _staticType(UNKNOWN_TYPE)
+    {
+    }
+
+public:
+    bool isConstant() const
+    {
+        return nodeType() == kNumber;
+    }
+
+    // The type of the values of the expression. Literals know it from the
+    // start, identifiers from the Binder and all other nodes from
+    // TypeInference; it is UNKNOWN_TYPE until then.
+    StaticType staticType() const
+    {
+        return _staticType;
+    }
+    void setStaticType(StaticType type)
+    {
+        _staticType = type;
+    }
+
+    // Type tests, returning NULL if the node is of a different class.
+#define DECLARE_TYPE_TEST(type) type* as##type();
+    EXPRESSION_NODE_LIST(DECLARE_TYPE_TEST)
+#undef DECLARE_TYPE_TEST
+};
+
+// An assignment, or with operation INIT_VAR or INIT_CONST the initializer
+// of a declaration such as 'double x = 1' or 'const n = 10'.
+class AssignmentExpression: public Expression
+{
+private:
+    Token::Type _operation;
+    Expression* _target;
+    Expression* _value;
+
+public:
+    AssignmentExpression(Token::Type operation, Expression* target,
+            Expression* value) :
+            Expression(kAssignmentExpression), _operation(operation),
+            _target(target), _value(value)
+    {
+    }
+
+    Token::Type operation() const
+    {
+        return _operation;
+    }
+    Expression* target() const
+    {
+        return _target;
+    }
+    Expression* value() const
+    {
+        return _value;
+    }
+};
+
+class UnaryOperationExpression: public Expression
+{
+private:
+    Token::Type _operation;
+    Expression* _expression;
+
+public:
+    UnaryOperationExpression(Token::Type operation, Expression* expression) :
+            Expression(kUnaryOperationExpression), _operation(operation),
+            _expression(expression)
+    {
+    }
+
+    Token::Type operation() const
+    {
+        return _operation;
+    }
+    Expression* expression() const
+    {
+        return _expression;
+    }
+};
+
+class BinaryOperationExpression: public Expression
+{
+private:
+    Token::Type _operation;
+    Expression* _left;
+    Expression* _right;
+
+public:
+    BinaryOperationExpression(Token::Type operation, Expression* left,
+            Expression* right) :
+            Expression(kBinaryOperationExpression), _operation(operation),
+            _left(left), _right(right)
+    {
+    }
+
+    Token::Type operation() const
+    {
+        return _operation;
+    }
+    Expression* left() const
+    {
+        return _left;
+    }
+    Expression* right() const
+    {
+        return _right;
+    }
+};
+
+class FunctionExpression: public Expression
+{
+private:
+    Expression* _identifier;
+    ZoneList<Expression*> _arguments;
+    int _builtin;
+
+public:
+    FunctionExpression(Expression* identifier,
+            const ZoneList<Expression*>& arguments) :
+            Expression(kFunctionExpression), _identifier(identifier),
+            _arguments(arguments), _builtin(-1)
+    {
+    }
+
+    // The Builtins::Id the call was bound to, -1 before binding.
+    int builtin() const
+    {
+        return _builtin;
+    }
+    void bind(int builtin)
+    {
+        _builtin = builtin;
+    }
+
+    Expression* identifier() const
+    {
+        return _identifier;
+    }
+    const ZoneList<Expression*>& arguments() const
+    {
+        return _arguments;
+    }
+};
+
+class Identifier: public Expression
+{
+private:
+    Symbol _symbol;
+    int _slot;
+    StaticType _declaredType;
+
+public:
+    // The symbol is interned in SymbolTable::Current(). The declared type
+    // is that named by a declaration such as 'int x', UNKNOWN_TYPE for
+    // other occurrences.
+    explicit Identifier(Symbol symbol,
+            StaticType declaredType = UNKNOWN_TYPE) :
+            Expression(kIdentifier), _symbol(symbol), _slot(-1),
+            _declaredType(declaredType)
+    {
+    }
+
+    // The environment slot of the variable, -1 before binding.
+    int slot() const
+    {
+        return _slot;
+    }
+    void bind(int slot)
+    {
+        _slot = slot;
+    }
+
+    Symbol symbol() const
+    {
+        return _symbol;
+    }
+
+    StaticType declaredType() const
+    {
+        return _declaredType;
+    }
+
+    const char* name() const
+    {
+        return SymbolTable::Current()->name(_symbol);
+    }
+    size_t length() const
+    {
+        return SymbolTable::Current()->length(_symbol);
+    }
+};
+
+class Number: public Expression
+{
+private:
+    Value _value;
+
+public:
+    Number(double value) :
+            Expression(kNumber), _value(value)
+    {
+        setStaticType(REAL_TYPE);
+    }
+
+    Number(long value) :
+            Expression(kNumber), _value(value)
+    {
+        setStaticType(INTEGER_TYPE);
+    }
+
+    Number(const Value& value) :
+            Expression(kNumber), _value(value)
+    {
+        setStaticType(value.isInteger() ? INTEGER_TYPE : REAL_TYPE);
+    }
+
+    Token::Type type() const
+    {
+        return _value.type();
+    }
+
+    const Value& value() const
+    {
+        return _value;
+    }
+
+    double real() const
+    {
+        return _value.real();
+    }
+
+    long integer() const
+    {
+        return _value.integer();
+    }
+
+    friend Number operator+(const Number &c1, const Number &c2)
+    {
+        return Number(c1._value + c2._value);
+    }
+
+    friend Number operator-(const Number &c1, const Number &c2)
+    {
+        return Number(c1._value - c2._value);
+    }
+
+    friend Number operator*(const Number &c1, const Number &c2)
+    {
+        return Number(c1._value * c2._value);
+    }
+
+    friend Number operator/(const Number &c1, const Number &c2)
+    {
+        return Number(c1._value / c2._value);
+    }
+
+    friend Number operator%(const Number &c1, const Number &c2)
+    {
+        return Number(c1._value % c2._value);
+    }
+
+    friend Number operator^(const Number &c1, const Number &c2)
+    {
+        return Number(c1._value ^ c2._value);
+    }
+};
+
+/* S t a t e m e n t s */
+class Statement: public AstNode
+{
+public:
+    bool IsEmpty() const
+    {
+        return false;
+    }
+
+protected:
+    explicit Statement(NodeType nodeType) :
+            AstNode(nodeType)
+    {
+    }
+};
+
+class ExpressionStatement: public Statement
+{
+private:
+    Expression *_expression;
+
+public:
+    explicit ExpressionStatement(Expression* expression) :
+            Statement(kExpressionStatement), _expression(expression)
+    {
+    }
+
+    Expression* expression() const
+    {
+        return _expression;
+    }
+};
+
+#define DEFINE_TYPE_TEST(type)                                            \
+    inline type* Expression::as##type()                                   \
+    {                                                                     \
+        return nodeType() == k##type ? static_cast<type*>(this) : NULL;   \
+    }
+EXPRESSION_NODE_LIST(DEFINE_TYPE_TEST)
+#undef DEFINE_TYPE_TEST
+
+// Base class for passes over expression trees. visit() switches on the
+// node type and calls the visit method of Derived for the class of the
+// node, so the methods of the pass are bound statically and may be
+// inlined. Derived implements one visit method per class of
+// EXPRESSION_NODE_LIST, usually declared with DECLARE_VISIT.
+template<typename Derived>
+class AstVisitor
+{
+public:
+    void visit(Expression* node)
+    {
+        Derived* self = static_cast<Derived*>(this);
+        switch (node->nodeType())
+        {
+#define DISPATCH_VISIT(type)                                              \
+        case AstNode::k##type:                                            \
+            self->visit##type(static_cast<type*>(node));                  \
+            break;
+        EXPRESSION_NODE_LIST(DISPATCH_VISIT)
+#undef DISPATCH_VISIT
+        default:
+            ASSERT(false);
+            break;
+        }
+    }
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_AST_H_ */
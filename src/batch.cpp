@@ -0,0 +1,634 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <cmath>
+#include <cstring>
+#include "batch.h"
+#include "builtins.h"
+#include "interpreter.h"
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace Doppio
+{
+
+typedef BatchInterpreter::Cell Cell;
+typedef BatchInterpreter::Step Step;
+
+static const int kBlockSize = BatchInterpreter::kBlockSize;
+
+static_assert(kBlockSize <= 32, "a block's lanes must fit in a uint32_t");
+
+/* K e r n e l s */
+
+#if defined(__AVX__)
+#define REAL_KERNEL(name, op, avx, sse)                                   \
+    static void name(const Step& s)                                       \
+    {                                                                     \
+        for (int i = 0; i < kBlockSize; i += 4)                           \
+        {                                                                 \
+            _mm256_storeu_pd(&s.dst[i].real,                              \
+                    avx(_mm256_loadu_pd(&s.a[i].real),                    \
+                            _mm256_loadu_pd(&s.b[i].real)));              \
+        }                                                                 \
+    }
+#elif defined(__SSE2__)
+#define REAL_KERNEL(name, op, avx, sse)                                   \
+    static void name(const Step& s)                                       \
+    {                                                                     \
+        for (int i = 0; i < kBlockSize; i += 2)                           \
+        {                                                                 \
+            _mm_storeu_pd(&s.dst[i].real,                                 \
+                    sse(_mm_loadu_pd(&s.a[i].real),                       \
+                            _mm_loadu_pd(&s.b[i].real)));                 \
+        }                                                                 \
+    }
+#else
+#define REAL_KERNEL(name, op, avx, sse)                                   \
+    static void name(const Step& s)                                       \
+    {                                                                     \
+        for (int i = 0; i < kBlockSize; i++)                              \
+        {                                                                 \
+            s.dst[i].real = s.a[i].real op s.b[i].real;                   \
+        }                                                                 \
+    }
+#endif
+
+REAL_KERNEL(addReal, +, _mm256_add_pd, _mm_add_pd)
+REAL_KERNEL(subReal, -, _mm256_sub_pd, _mm_sub_pd)
+REAL_KERNEL(mulReal, *, _mm256_mul_pd, _mm_mul_pd)
+REAL_KERNEL(divReal, /, _mm256_div_pd, _mm_div_pd)
+
+#undef REAL_KERNEL
+
+// x - n * floor(x / n), as in Value.
+static void modReal(const Step& s)
+{
+#if defined(__AVX__)
+    for (int i = 0; i < kBlockSize; i += 4)
+    {
+        __m256d x = _mm256_loadu_pd(&s.a[i].real);
+        __m256d n = _mm256_loadu_pd(&s.b[i].real);
+        __m256d q = _mm256_floor_pd(_mm256_div_pd(x, n));
+        _mm256_storeu_pd(&s.dst[i].real, _mm256_sub_pd(x, _mm256_mul_pd(n, q)));
+    }
+#elif defined(__SSE4_1__)
+    for (int i = 0; i < kBlockSize; i += 2)
+    {
+        __m128d x = _mm_loadu_pd(&s.a[i].real);
+        __m128d n = _mm_loadu_pd(&s.b[i].real);
+        __m128d q = _mm_floor_pd(_mm_div_pd(x, n));
+        _mm_storeu_pd(&s.dst[i].real, _mm_sub_pd(x, _mm_mul_pd(n, q)));
+    }
+#else
+    for (int i = 0; i < kBlockSize; i++)
+    {
+        double x = s.a[i].real;
+        double n = s.b[i].real;
+        s.dst[i].real = x - n * floor(x / n);
+    }
+#endif
+}
+
+static void powReal(const Step& s)
+{
+    for (int i = 0; i < kBlockSize; i++)
+    {
+        s.dst[i].real = pow(s.a[i].real, s.b[i].real);
+    }
+}
+
+// Integer arithmetic wraps around like the hardware does; going through
+// unsigned long keeps it defined.
+#if defined(__AVX2__)
+#define INTEGER_KERNEL(name, op, avx2, sse2)                              \
+    static void name(const Step& s)                                       \
+    {                                                                     \
+        for (int i = 0; i < kBlockSize; i += 4)                           \
+        {                                                                 \
+            _mm256_storeu_si256((__m256i*) &s.dst[i],                     \
+                    avx2(_mm256_loadu_si256((const __m256i*) &s.a[i]),    \
+                            _mm256_loadu_si256((const __m256i*) &s.b[i]))); \
+        }                                                                 \
+    }
+#elif defined(__SSE2__)
+#define INTEGER_KERNEL(name, op, avx2, sse2)                              \
+    static void name(const Step& s)                                       \
+    {                                                                     \
+        for (int i = 0; i < kBlockSize; i += 2)                           \
+        {                                                                 \
+            _mm_storeu_si128((__m128i*) &s.dst[i],                        \
+                    sse2(_mm_loadu_si128((const __m128i*) &s.a[i]),       \
+                            _mm_loadu_si128((const __m128i*) &s.b[i])));  \
+        }                                                                 \
+    }
+#else
+#define INTEGER_KERNEL(name, op, avx2, sse2)                              \
+    static void name(const Step& s)                                       \
+    {                                                                     \
+        for (int i = 0; i < kBlockSize; i++)                              \
+        {                                                                 \
+            s.dst[i].integer = (long) ((unsigned long) s.a[i].integer     \
+                    op (unsigned long) s.b[i].integer);                   \
+        }                                                                 \
+    }
+#endif
+
+INTEGER_KERNEL(addInteger, +, _mm256_add_epi64, _mm_add_epi64)
+INTEGER_KERNEL(subInteger, -, _mm256_sub_epi64, _mm_sub_epi64)
+
+#undef INTEGER_KERNEL
+
+// There is no packed 64-bit multiply below AVX-512.
+static void mulInteger(const Step& s)
+{
+    for (int i = 0; i < kBlockSize; i++)
+    {
+        s.dst[i].integer = (long) ((unsigned long) s.a[i].integer
+                * (unsigned long) s.b[i].integer);
+    }
+}
+
+// Remainder by a divisor known to be non-zero.
+static void modInteger(const Step& s)
+{
+    for (int i = 0; i < kBlockSize; i++)
+    {
+        long n = s.b[i].integer;
+        s.dst[i].integer = n == -1 ? 0 : s.a[i].integer % n;
+    }
+}
+
+// Remainder by a divisor that may be zero. Value has no integer result
+// for a zero divisor, so those lanes are left to the Interpreter.
+static void modIntegerChecked(const Step& s)
+{
+    uint32_t zeros = 0;
+    for (int i = 0; i < kBlockSize; i++)
+    {
+        long n = s.b[i].integer;
+        if (n == 0)
+        {
+            zeros |= 1u << i;
+            s.dst[i].integer = 0;
+        }
+        else
+        {
+            s.dst[i].integer = n == -1 ? 0 : s.a[i].integer % n;
+        }
+    }
+    *s.scalarLanes |= zeros;
+}
+
+static void factorialInteger(const Step& s)
+{
+    for (int i = 0; i < kBlockSize; i++)
+    {
+        s.dst[i].integer = Value::factorial(Value(s.a[i].integer)).integer();
+    }
+}
+
+static void factorialReal(const Step& s)
+{
+    for (int i = 0; i < kBlockSize; i++)
+    {
+        s.dst[i].integer = Value::factorial(Value(s.a[i].real)).integer();
+    }
+}
+
+static void call1(const Step& s)
+{
+    Builtins::Function1 function = Builtins::Function1Of(
+            (Builtins::Id) s.builtin);
+    for (int i = 0; i < kBlockSize; i++)
+    {
+        s.dst[i].real = function(s.a[i].real);
+    }
+}
+
+static void call2(const Step& s)
+{
+    Builtins::Function2 function = Builtins::Function2Of(
+            (Builtins::Id) s.builtin);
+    for (int i = 0; i < kBlockSize; i++)
+    {
+        s.dst[i].real = function(s.a[i].real, s.b[i].real);
+    }
+}
+
+static void move(const Step& s)
+{
+    memcpy(s.dst, s.a, kBlockSize * sizeof(Cell));
+}
+
+static void toInteger(const Step& s)
+{
+    for (int i = 0; i < kBlockSize; i++)
+    {
+        s.dst[i].integer = (long) s.a[i].real;
+    }
+}
+
+static void toReal(const Step& s)
+{
+    for (int i = 0; i < kBlockSize; i++)
+    {
+        s.dst[i].real = (double) s.a[i].integer;
+    }
+}
+
+/* P l a n n i n g */
+
+namespace
+{
+
+// Assigns a static type to every register at every instruction and picks
+// the kernels. Registers are numbered as in the bytecode; scratch registers
+// for int to real conversions are appended after them.
+class Planner
+{
+public:
+    struct PlannedStep
+    {
+        BatchInterpreter::Kernel kernel;
+        int dst;
+        int a;
+        int b;
+        int builtin;
+    };
+
+    std::vector<PlannedStep> steps;
+    std::vector<Token::Type> types;
+    std::vector<Cell> constants;
+    std::vector<int> constantRegisters;
+    int registerCount;
+
+    // Whether some step may leave lanes to the Interpreter.
+    bool checked;
+
+    Planner(const Bytecode* bytecode, const Token::Type* columnTypes) :
+            checked(false), _bytecode(bytecode)
+    {
+        registerCount = bytecode->registerCount();
+        types.resize(registerCount, Token::NUMBER_FLOAT);
+        for (int i = 0; i < bytecode->variableCount(); i++)
+        {
+            types[i] = columnTypes[i];
+        }
+        const std::vector<Value>& values = bytecode->constants();
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            int reg = bytecode->constantBase() + i;
+            types[reg] = values[i].type();
+            Cell cell;
+            if (values[i].isInteger())
+            {
+                cell.integer = values[i].integer();
+            }
+            else
+            {
+                cell.real = values[i].real();
+            }
+            addConstant(reg, cell);
+        }
+    }
+
+    bool isConstant(int reg) const
+    {
+        return reg >= _bytecode->constantBase()
+                && reg < _bytecode->registerCount();
+    }
+
+    void addConstant(int reg, Cell cell)
+    {
+        constantRegisters.push_back(reg);
+        constants.push_back(cell);
+    }
+
+    int newRegister(Token::Type type)
+    {
+        types.push_back(type);
+        return registerCount++;
+    }
+
+    // Returns a register holding the value of reg as a real. Constants
+    // are converted once, other registers by a step.
+    int real(int reg)
+    {
+        if (types[reg] == Token::NUMBER_FLOAT)
+        {
+            return reg;
+        }
+        int result = newRegister(Token::NUMBER_FLOAT);
+        if (isConstant(reg))
+        {
+            Cell cell;
+            cell.real = (double) constantValue(reg).integer;
+            addConstant(result, cell);
+        }
+        else
+        {
+            add(toReal, result, reg);
+        }
+        return result;
+    }
+
+    Cell constantValue(int reg) const
+    {
+        for (size_t i = 0; i < constantRegisters.size(); i++)
+        {
+            if (constantRegisters[i] == reg)
+            {
+                return constants[i];
+            }
+        }
+        ASSERT(false);
+        return Cell();
+    }
+
+    void add(BatchInterpreter::Kernel kernel, int dst, int a, int b = 0,
+            int builtin = 0)
+    {
+        PlannedStep step = { kernel, dst, a, b, builtin };
+        steps.push_back(step);
+    }
+
+    void binary(const Instruction& instruction)
+    {
+        int dst = instruction.dst;
+        int a = instruction.a;
+        int b = instruction.b;
+        bool integers = types[a] == Token::NUMBER_INTEGER
+                && types[b] == Token::NUMBER_INTEGER;
+        switch (instruction.opcode)
+        {
+        case Instruction::ADD:
+        case Instruction::ADD_INTEGER:
+        case Instruction::ADD_REAL:
+            arithmetic(integers, addInteger, addReal, dst, a, b);
+            break;
+        case Instruction::SUB:
+        case Instruction::SUB_INTEGER:
+        case Instruction::SUB_REAL:
+            arithmetic(integers, subInteger, subReal, dst, a, b);
+            break;
+        case Instruction::MUL:
+        case Instruction::MUL_INTEGER:
+        case Instruction::MUL_REAL:
+            arithmetic(integers, mulInteger, mulReal, dst, a, b);
+            break;
+        case Instruction::DIV:
+        case Instruction::DIV_REAL:
+            add(divReal, dst, real(a), real(b));
+            integers = false;
+            break;
+        case Instruction::MOD:
+        case Instruction::MOD_INTEGER:
+        case Instruction::MOD_REAL:
+            if (integers && isConstant(b) && constantValue(b).integer != 0)
+            {
+                add(modInteger, dst, a, b);
+            }
+            else if (integers)
+            {
+                add(modIntegerChecked, dst, a, b);
+                checked = true;
+            }
+            else
+            {
+                add(modReal, dst, real(a), real(b));
+            }
+            break;
+        case Instruction::POW:
+        case Instruction::POW_REAL:
+            add(powReal, dst, real(a), real(b));
+            integers = false;
+            break;
+        default:
+            ASSERT(false);
+            break;
+        }
+        types[dst] = integers ? Token::NUMBER_INTEGER : Token::NUMBER_FLOAT;
+    }
+
+private:
+    const Bytecode* _bytecode;
+
+    void arithmetic(bool integers, BatchInterpreter::Kernel integerKernel,
+            BatchInterpreter::Kernel realKernel, int dst, int a, int b)
+    {
+        if (integers)
+        {
+            add(integerKernel, dst, a, b);
+        }
+        else
+        {
+            add(realKernel, dst, real(a), real(b));
+        }
+    }
+};
+
+} /* anonymous namespace */
+
+BatchInterpreter::BatchInterpreter(const Bytecode* bytecode,
+        const Token::Type* columnTypes) :
+        _bytecode(bytecode), _result(NULL), _resultType(Token::NUMBER_FLOAT),
+        _scalarLanes(0), _interpreter(NULL)
+{
+    Planner planner(bytecode, columnTypes);
+    for (int slot = 0; slot < bytecode->variableCount(); slot++)
+    {
+        // typed variables are converted in place once loaded
+        StaticType type = bytecode->variableType(slot);
+        if (type == INTEGER_TYPE && columnTypes[slot] == Token::NUMBER_FLOAT)
+        {
+            planner.add(toInteger, slot, slot);
+            planner.types[slot] = Token::NUMBER_INTEGER;
+        }
+        else if (type == REAL_TYPE
+                && columnTypes[slot] == Token::NUMBER_INTEGER)
+        {
+            planner.add(toReal, slot, slot);
+            planner.types[slot] = Token::NUMBER_FLOAT;
+        }
+    }
+
+    const std::vector<Instruction>& code = bytecode->instructions();
+    int result = 0;
+    for (size_t i = 0; i < code.size(); i++)
+    {
+        const Instruction& instruction = code[i];
+        switch (instruction.opcode)
+        {
+        case Instruction::TO_INTEGER:
+            planner.add(planner.types[instruction.a] == Token::NUMBER_FLOAT ?
+                    toInteger : move, instruction.dst, instruction.a);
+            planner.types[instruction.dst] = Token::NUMBER_INTEGER;
+            break;
+        case Instruction::TO_REAL:
+            planner.add(planner.types[instruction.a] == Token::NUMBER_INTEGER ?
+                    toReal : move, instruction.dst, instruction.a);
+            planner.types[instruction.dst] = Token::NUMBER_FLOAT;
+            break;
+        case Instruction::FACTORIAL:
+            planner.add(planner.types[instruction.a] == Token::NUMBER_INTEGER ?
+                    factorialInteger : factorialReal, instruction.dst,
+                    instruction.a);
+            planner.types[instruction.dst] = Token::NUMBER_INTEGER;
+            break;
+        case Instruction::ASSIGN:
+        case Instruction::MOVE:
+            planner.add(move, instruction.dst, instruction.a);
+            planner.types[instruction.dst] = planner.types[instruction.a];
+            break;
+        case Instruction::CALL1:
+            planner.add(call1, instruction.dst, planner.real(instruction.a), 0,
+                    instruction.builtin);
+            planner.types[instruction.dst] = Token::NUMBER_FLOAT;
+            break;
+        case Instruction::CALL2:
+            planner.add(call2, instruction.dst, planner.real(instruction.a),
+                    planner.real(instruction.b), instruction.builtin);
+            planner.types[instruction.dst] = Token::NUMBER_FLOAT;
+            break;
+        case Instruction::RETURN:
+            result = instruction.a;
+            _resultType = planner.types[result];
+            break;
+        default:
+            planner.binary(instruction);
+            break;
+        }
+    }
+
+    // 32 bytes of slack to align the register file for AVX
+    size_t size = planner.registerCount * kBlockSize * sizeof(Cell);
+    _memory = new char[size + 32];
+    _registers = (Cell*) (((size_t) _memory + 31) & ~(size_t) 31);
+    memset(_registers, 0, size);
+    _result = _registers + result * kBlockSize;
+
+    for (size_t i = 0; i < planner.constants.size(); i++)
+    {
+        Cell* cells = _registers + planner.constantRegisters[i] * kBlockSize;
+        for (int lane = 0; lane < kBlockSize; lane++)
+        {
+            cells[lane] = planner.constants[i];
+        }
+    }
+    for (size_t i = 0; i < planner.steps.size(); i++)
+    {
+        const Planner::PlannedStep& planned = planner.steps[i];
+        Step step = { planned.kernel, _registers + planned.dst * kBlockSize,
+                _registers + planned.a * kBlockSize, _registers
+                        + planned.b * kBlockSize, planned.builtin,
+                &_scalarLanes };
+        _steps.push_back(step);
+    }
+
+    if (planner.checked)
+    {
+        _interpreter = new Interpreter(bytecode);
+        _environment.resize(bytecode->variableCount());
+        for (int slot = 0; slot < bytecode->variableCount(); slot++)
+        {
+            _columnTypes.push_back(columnTypes[slot]);
+        }
+    }
+}
+
+BatchInterpreter::~BatchInterpreter()
+{
+    delete _interpreter;
+    delete[] _memory;
+}
+
+void BatchInterpreter::evaluate(const void* const* columns, size_t n,
+        double* out)
+{
+    int variableCount = _bytecode->variableCount();
+    const Step* steps = _steps.data();
+    size_t stepCount = _steps.size();
+
+    for (size_t row = 0; row < n; row += kBlockSize)
+    {
+        size_t lanes = n - row < (size_t) kBlockSize ? n - row : kBlockSize;
+
+        // longs and doubles are both 8 bytes wide, so a column block is
+        // copied into its register the same way whatever its type
+        for (int slot = 0; slot < variableCount; slot++)
+        {
+            Cell* cells = _registers + slot * kBlockSize;
+            memcpy(cells, (const Cell*) columns[slot] + row,
+                    lanes * sizeof(Cell));
+            if (lanes < (size_t) kBlockSize)
+            {
+                memset(cells + lanes, 0, (kBlockSize - lanes) * sizeof(Cell));
+            }
+        }
+
+        _scalarLanes = 0;
+        for (size_t i = 0; i < stepCount; i++)
+        {
+            steps[i].kernel(steps[i]);
+        }
+
+        if (_resultType == Token::NUMBER_INTEGER)
+        {
+            for (size_t lane = 0; lane < lanes; lane++)
+            {
+                out[row + lane] = (double) _result[lane].integer;
+            }
+        }
+        else
+        {
+            for (size_t lane = 0; lane < lanes; lane++)
+            {
+                out[row + lane] = _result[lane].real;
+            }
+        }
+        if (_scalarLanes != 0)
+        {
+            evaluateScalar(columns, row, lanes, out);
+        }
+    }
+}
+
+void BatchInterpreter::evaluateScalar(const void* const* columns,
+        size_t row, size_t lanes, double* out)
+{
+    for (size_t lane = 0; lane < lanes; lane++)
+    {
+        if (!(_scalarLanes & (1u << lane)))
+        {
+            continue;
+        }
+        for (size_t slot = 0; slot < _environment.size(); slot++)
+        {
+            const Cell& cell = ((const Cell*) columns[slot])[row + lane];
+            _environment[slot] = _columnTypes[slot] == Token::NUMBER_INTEGER ?
+                    Value(cell.integer) : Value(cell.real);
+        }
+        out[row + lane] = _interpreter->evaluate(_environment.data()).real();
+    }
+}
+
+} /* Doppio namespace */
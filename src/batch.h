@@ -0,0 +1,114 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_BATCH_H_
+#define DOPPIO_BATCH_H_
+
+#include <stdint.h>
+#include <vector>
+#include "bytecode.h"
+
+namespace Doppio
+{
+
+class Interpreter;
+
+// Evaluates one Bytecode program over many rows of columnar input. Every
+// variable of the program is a column of either longs or doubles. Rows are
+// processed in blocks of kBlockSize lanes and each instruction runs over a
+// whole block with a single kernel call, so the interpreter overhead is
+// paid once per block rather than once per row.
+//
+// Kernels use AVX/AVX2 or SSE2/SSE4.1 when the compiler targets them and
+// plain loops otherwise.
+//
+// Because the column types fix the type of every register, the int/float
+// semantics of Value are resolved when the plan is built. The one value
+// that cannot be typed statically is an integer remainder by a divisor
+// that may be zero, which Value turns into a real NaN. Such remainders
+// stay integers, and the rows of a block in which a divisor is zero are
+// evaluated again by a scalar Interpreter.
+class BatchInterpreter
+{
+public:
+    static const int kBlockSize = 16;
+
+    // columnTypes holds NUMBER_INTEGER or NUMBER_FLOAT for every variable
+    // of the program. Columns of typed variables are converted to the
+    // declared type as they are loaded.
+    BatchInterpreter(const Bytecode* bytecode, const Token::Type* columnTypes);
+    ~BatchInterpreter();
+
+    // columns[slot] points to n longs or doubles, according to the type
+    // given for the slot. The result of row i is stored in out[i].
+    // Assignments update the interpreter's registers, not the columns.
+    void evaluate(const void* const* columns, size_t n, double* out);
+
+    // The type the result has before it is stored in out.
+    Token::Type resultType() const
+    {
+        return _resultType;
+    }
+
+    union Cell
+    {
+        double real;
+        long integer;
+    };
+
+    struct Step;
+    typedef void (*Kernel)(const Step& step);
+
+    struct Step
+    {
+        Kernel kernel;
+        Cell* dst;
+        const Cell* a;
+        const Cell* b;
+        int builtin;
+        // Lanes of the block that the kernel could not compute, one bit
+        // each.
+        uint32_t* scalarLanes;
+    };
+
+private:
+    const Bytecode* _bytecode;
+    std::vector<Step> _steps;
+    char* _memory;
+    Cell* _registers;
+    Cell* _result;
+    Token::Type _resultType;
+    uint32_t _scalarLanes;
+
+    // With a checked remainder: evaluates the rows of _scalarLanes.
+    Interpreter* _interpreter;
+    std::vector<Token::Type> _columnTypes;
+    std::vector<Value> _environment;
+
+    void evaluateScalar(const void* const* columns, size_t row,
+            size_t lanes, double* out);
+
+    // Batch interpreters are not copyable.
+    BatchInterpreter(const BatchInterpreter&);
+    BatchInterpreter& operator=(const BatchInterpreter&);
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_BATCH_H_ */
@@ -0,0 +1,445 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <chrono>
+#include "benchmark.h"
+#include "binder.h"
+#include "compiler.h"
+#include "evaluator.h"
+#include "flat.h"
+#include "interpreter.h"
+#include "jit.h"
+#include "parser.h"
+
+namespace Doppio
+{
+
+namespace
+{
+
+class NodeCounter: public AstVisitor<NodeCounter>
+{
+public:
+    NodeCounter() :
+            _count(0)
+    {
+    }
+
+    size_t count(Expression* expression)
+    {
+        visit(expression);
+        return _count;
+    }
+
+    void visitAssignmentExpression(AssignmentExpression* node)
+    {
+        _count++;
+        visit(node->target());
+        visit(node->value());
+    }
+
+    void visitUnaryOperationExpression(UnaryOperationExpression* node)
+    {
+        _count++;
+        visit(node->expression());
+    }
+
+    void visitBinaryOperationExpression(
+            BinaryOperationExpression* node)
+    {
+        _count++;
+        visit(node->left());
+        visit(node->right());
+    }
+
+    void visitFunctionExpression(FunctionExpression* node)
+    {
+        _count++;
+        visit(node->identifier());
+        for (int i = 0; i < node->arguments().length(); i++)
+        {
+            visit(node->arguments()[i]);
+        }
+    }
+
+    void visitIdentifier(Identifier*)
+    {
+        _count++;
+    }
+
+    void visitNumber(Number*)
+    {
+        _count++;
+    }
+
+private:
+    size_t _count;
+};
+
+// The corpus as one ';'-separated program, with the span of each formula.
+struct Formulas
+{
+    std::string text;
+    std::vector<size_t> starts;
+    std::vector<size_t> lengths;
+};
+
+// One pass of each measured operation. The result keeps the work from
+// being optimized away.
+class ScanPass
+{
+public:
+    explicit ScanPass(const Formulas& formulas) :
+            _formulas(formulas)
+    {
+    }
+
+    size_t operator()()
+    {
+        Scanner scanner(_formulas.text.data(), _formulas.text.size());
+        size_t tokens = 0;
+        while (scanner.next() != Token::EOS)
+        {
+            tokens++;
+        }
+        return tokens;
+    }
+
+private:
+    const Formulas& _formulas;
+};
+
+class ParsePass
+{
+public:
+    ParsePass(const Formulas& formulas, Zone* zone) :
+            _formulas(formulas), _zone(zone), _parser(NULL, 0, zone)
+    {
+    }
+
+    size_t operator()()
+    {
+        _zone->deleteAll();
+        size_t parsed = 0;
+        for (size_t i = 0; i < _formulas.starts.size(); i++)
+        {
+            _parser.reset(_formulas.text.data() + _formulas.starts[i],
+                    _formulas.lengths[i]);
+            parsed += _parser.parseExpression() != NULL;
+        }
+        return parsed;
+    }
+
+private:
+    const Formulas& _formulas;
+    Zone* _zone;
+    Parser _parser;
+};
+
+class EvaluatorPass
+{
+public:
+    EvaluatorPass(std::vector<Evaluator*>& evaluators,
+            const std::vector<Value>& environment) :
+            _evaluators(evaluators), _initial(environment)
+    {
+    }
+
+    double operator()()
+    {
+        // assignments must not carry over to the next pass
+        _environment = _initial;
+        double sum = 0;
+        for (size_t i = 0; i < _evaluators.size(); i++)
+        {
+            sum += _evaluators[i]->evaluate(_environment.data()).real();
+        }
+        return sum;
+    }
+
+private:
+    std::vector<Evaluator*>& _evaluators;
+    const std::vector<Value>& _initial;
+    std::vector<Value> _environment;
+};
+
+class FlatPass
+{
+public:
+    FlatPass(std::vector<FlatEvaluator*>& evaluators,
+            const std::vector<Value>& environment) :
+            _evaluators(evaluators), _initial(environment)
+    {
+    }
+
+    double operator()()
+    {
+        _environment = _initial;
+        double sum = 0;
+        for (size_t i = 0; i < _evaluators.size(); i++)
+        {
+            sum += _evaluators[i]->evaluate(_environment.data()).real();
+        }
+        return sum;
+    }
+
+private:
+    std::vector<FlatEvaluator*>& _evaluators;
+    const std::vector<Value>& _initial;
+    std::vector<Value> _environment;
+};
+
+class InterpreterPass
+{
+public:
+    InterpreterPass(std::vector<Interpreter*>& interpreters,
+            const std::vector<Value>& environment) :
+            _interpreters(interpreters), _initial(environment)
+    {
+    }
+
+    double operator()()
+    {
+        _environment = _initial;
+        double sum = 0;
+        for (size_t i = 0; i < _interpreters.size(); i++)
+        {
+            sum += _interpreters[i]->evaluate(_environment.data()).real();
+        }
+        return sum;
+    }
+
+private:
+    std::vector<Interpreter*>& _interpreters;
+    const std::vector<Value>& _initial;
+    std::vector<Value> _environment;
+};
+
+class CompiledPass
+{
+public:
+    CompiledPass(std::vector<CompiledExpression*>& expressions,
+            const double* variables) :
+            _expressions(expressions), _variables(variables)
+    {
+    }
+
+    double operator()()
+    {
+        double sum = 0;
+        for (size_t i = 0; i < _expressions.size(); i++)
+        {
+            sum += _expressions[i]->evaluate(_variables);
+        }
+        return sum;
+    }
+
+private:
+    std::vector<CompiledExpression*>& _expressions;
+    const double* _variables;
+};
+
+volatile double sink;
+
+} /* anonymous namespace */
+
+Benchmark::Benchmark(double minimumSeconds) :
+        _minimumSeconds(minimumSeconds)
+{
+}
+
+std::vector<Benchmark::Corpus> Benchmark::DefaultCorpora()
+{
+    std::vector<Corpus> corpora;
+    Corpus corpus;
+
+    corpus.name = "short";
+    corpus.options = FormulaGenerator::Options();
+    corpus.options.depth = 2;
+    corpus.options.width = 3;
+    corpus.formulas = 20000;
+    corpora.push_back(corpus);
+
+    corpus.name = "wide";
+    corpus.options = FormulaGenerator::Options();
+    corpus.options.depth = 1;
+    corpus.options.width = 64;
+    corpus.formulas = 2000;
+    corpora.push_back(corpus);
+
+    corpus.name = "deep";
+    corpus.options = FormulaGenerator::Options();
+    corpus.options.depth = 12;
+    corpus.options.width = 2;
+    corpus.formulas = 2000;
+    corpora.push_back(corpus);
+
+    corpus.name = "literals";
+    corpus.options = FormulaGenerator::Options();
+    corpus.options.literalRatio = 0.8;
+    corpus.formulas = 10000;
+    corpora.push_back(corpus);
+
+    corpus.name = "identifiers";
+    corpus.options = FormulaGenerator::Options();
+    corpus.options.literalRatio = 0.1;
+    corpus.options.identifierCount = 4096;
+    corpus.formulas = 10000;
+    corpora.push_back(corpus);
+
+    return corpora;
+}
+
+// Returns the seconds per call of operation, repeating it for at least
+// _minimumSeconds.
+template<typename Operation>
+double Benchmark::measure(Operation& operation)
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    double elapsed;
+    long calls = 0;
+    do
+    {
+        sink = sink + (double) operation();
+        calls++;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < _minimumSeconds);
+    return elapsed / calls;
+}
+
+void Benchmark::run(const Corpus& corpus)
+{
+    Formulas formulas;
+    FormulaGenerator generator(corpus.options);
+    for (int i = 0; i < corpus.formulas; i++)
+    {
+        formulas.starts.push_back(formulas.text.size());
+        generator.generate(&formulas.text);
+        formulas.lengths.push_back(formulas.text.size() - formulas.starts[i]);
+        formulas.text.append(";\n");
+    }
+
+    BenchmarkResult result;
+    memset(&result, 0, sizeof(result));
+    result.corpus = corpus.name;
+    result.formulas = corpus.formulas;
+    result.bytes = formulas.text.size();
+
+    ScanPass scan(formulas);
+    result.tokens = scan();
+    result.tokensPerSecond = result.tokens / measure(scan);
+
+    // trees for counting and evaluation stay in their own zone
+    Zone zone;
+    Scope scope;
+    std::vector<Expression*> trees;
+    for (int i = 0; i < corpus.formulas; i++)
+    {
+        Parser parser(formulas.text.data() + formulas.starts[i],
+                formulas.lengths[i], &zone);
+        Expression* tree = parser.parseExpression();
+        ASSERT(tree != NULL);
+        result.nodes += NodeCounter().count(tree);
+        Binder binder(&scope);
+        bool bound = binder.bind(tree);
+        ASSERT(bound);
+        (void) bound;
+        trees.push_back(tree);
+    }
+
+    Zone parseZone;
+    ParsePass parse(formulas, &parseZone);
+    parse();
+    result.bytesPerNode = (double) parseZone.allocationSize() / result.nodes;
+    result.nodesPerSecond = result.nodes / measure(parse);
+
+    std::vector<Value> environment(scope.variableCount());
+    std::vector<double> variables(scope.variableCount());
+    for (int i = 0; i < scope.variableCount(); i++)
+    {
+        variables[i] = 1.0 + i / 64.0;
+        environment[i] = Value(variables[i]);
+    }
+
+    std::vector<Evaluator*> evaluators;
+    std::vector<FlatTree*> flatTrees;
+    std::vector<FlatEvaluator*> flatEvaluators;
+    std::vector<Bytecode*> programs;
+    std::vector<Interpreter*> interpreters;
+    std::vector<CompiledExpression*> compiled;
+    size_t flatBytes = 0;
+    size_t flatNodes = 0;
+    for (size_t i = 0; i < trees.size(); i++)
+    {
+        evaluators.push_back(new Evaluator(trees[i]));
+        flatTrees.push_back(new FlatTree(trees[i]));
+        flatEvaluators.push_back(new FlatEvaluator(flatTrees[i]));
+        flatBytes += flatTrees[i]->memoryUsage();
+        flatNodes += flatTrees[i]->length();
+        programs.push_back(BytecodeCompiler().compile(trees[i], &scope));
+        interpreters.push_back(new Interpreter(programs[i]));
+        compiled.push_back(new CompiledExpression(trees[i], &scope));
+    }
+
+    EvaluatorPass evaluate(evaluators, environment);
+    result.evaluatorNanoseconds = 1e9 * measure(evaluate) / trees.size();
+    FlatPass flat(flatEvaluators, environment);
+    result.flatNanoseconds = 1e9 * measure(flat) / trees.size();
+    result.flatBytesPerNode = (double) flatBytes / flatNodes;
+    InterpreterPass interpret(interpreters, environment);
+    result.interpreterNanoseconds = 1e9 * measure(interpret) / trees.size();
+    CompiledPass run(compiled, variables.data());
+    result.compiledNanoseconds = 1e9 * measure(run) / trees.size();
+
+    for (size_t i = 0; i < trees.size(); i++)
+    {
+        delete compiled[i];
+        delete interpreters[i];
+        delete programs[i];
+        delete flatEvaluators[i];
+        delete flatTrees[i];
+        delete evaluators[i];
+    }
+    _results.push_back(result);
+}
+
+void Benchmark::writeJson(FILE* out) const
+{
+    fprintf(out, "{\"benchmarks\": [");
+    for (size_t i = 0; i < _results.size(); i++)
+    {
+        const BenchmarkResult& result = _results[i];
+        fprintf(out, "%s\n  {\"corpus\": \"%s\", \"formulas\": %zu, "
+                "\"bytes\": %zu, \"tokens\": %zu, \"nodes\": %zu, "
+                "\"tokens_per_second\": %.6g, \"nodes_per_second\": %.6g, "
+                "\"bytes_per_node\": %.4g, \"flat_bytes_per_node\": %.4g, "
+                "\"evaluator_ns\": %.4g, \"flat_ns\": %.4g, "
+                "\"interpreter_ns\": %.4g, \"compiled_ns\": %.4g}",
+                i ? "," : "", result.corpus, result.formulas, result.bytes,
+                result.tokens, result.nodes, result.tokensPerSecond,
+                result.nodesPerSecond, result.bytesPerNode,
+                result.flatBytesPerNode, result.evaluatorNanoseconds,
+                result.flatNanoseconds, result.interpreterNanoseconds,
+                result.compiledNanoseconds);
+    }
+    fprintf(out, "\n]}\n");
+}
+
+} /* Doppio namespace */
@@ -0,0 +1,101 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_BENCHMARK_H_
+#define DOPPIO_BENCHMARK_H_
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "generator.h"
+
+namespace Doppio
+{
+
+// Measurements over one corpus of generated formulas. Rates are per
+// second of wall time on the calling thread.
+struct BenchmarkResult
+{
+    const char* corpus;
+    size_t formulas;
+    size_t bytes;
+    size_t tokens;
+
+    // Nodes of the parsed trees, after the parser's constant folding.
+    size_t nodes;
+
+    double tokensPerSecond;
+    double nodesPerSecond;
+
+    // Zone bytes allocated by the parser per node, and bytes of the
+    // FlatTree form, side tables included, per flat node.
+    double bytesPerNode;
+    double flatBytesPerNode;
+
+    // Nanoseconds per evaluation of one formula by the tree-walking
+    // Evaluator, the FlatEvaluator, the bytecode Interpreter and
+    // CompiledExpression, which runs native code where the JIT supports it.
+    double evaluatorNanoseconds;
+    double flatNanoseconds;
+    double interpreterNanoseconds;
+    double compiledNanoseconds;
+};
+
+// Measures the scanner, the parser and the evaluators on corpora from the
+// FormulaGenerator and writes the results as JSON, so that runs can be
+// compared. Every measurement is repeated until it took at least the
+// given time.
+class Benchmark
+{
+public:
+    struct Corpus
+    {
+        const char* name;
+        FormulaGenerator::Options options;
+        int formulas;
+    };
+
+    explicit Benchmark(double minimumSeconds = 0.2);
+
+    // Representative corpora: short formulas, long operator chains, deep
+    // nesting, literal-heavy formulas and many distinct variables.
+    static std::vector<Corpus> DefaultCorpora();
+
+    // Measures the corpus and appends its result.
+    void run(const Corpus& corpus);
+
+    const std::vector<BenchmarkResult>& results() const
+    {
+        return _results;
+    }
+
+    // Writes {"benchmarks": [...]} with one object per result.
+    void writeJson(FILE* out) const;
+
+private:
+    double _minimumSeconds;
+    std::vector<BenchmarkResult> _results;
+
+    template<typename Operation>
+    double measure(Operation& operation);
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_BENCHMARK_H_ */
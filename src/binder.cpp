@@ -0,0 +1,143 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "binder.h"
+#include "builtins.h"
+
+namespace Doppio
+{
+
+Binder::Binder(Scope* scope) :
+        _scope(scope), _error(NULL)
+{
+}
+
+Binder::~Binder()
+{
+}
+
+bool Binder::bind(Expression* expression)
+{
+    _error = NULL;
+    visit(expression);
+    return _error == NULL;
+}
+
+void Binder::fail(const char* message)
+{
+    if (!_error)
+    {
+        _error = message;
+    }
+}
+
+void Binder::bindIdentifier(Identifier* node, int slot)
+{
+    node->bind(slot);
+    node->setStaticType(_scope->variableType(slot));
+}
+
+void Binder::declare(Identifier* node, bool constant)
+{
+    int slot = _scope->declare(node->symbol(), node->declaredType(),
+            constant);
+    if (slot < 0)
+    {
+        fail("Variable declared differently before");
+        slot = _scope->lookup(node->symbol());
+    }
+    bindIdentifier(node, slot);
+}
+
+void Binder::visitAssignmentExpression(AssignmentExpression* node)
+{
+    Identifier* target = node->target()->asIdentifier();
+    if (!target)
+    {
+        fail("Only variables can be assigned to");
+        visit(node->target());
+    }
+    else if (node->operation() == Token::ASSIGN)
+    {
+        visit(target);
+        if (_scope->isConstant(target->slot()))
+        {
+            fail("Constants cannot be assigned to");
+        }
+    }
+    else
+    {
+        declare(target, node->operation() == Token::INIT_CONST);
+    }
+    visit(node->value());
+}
+
+void Binder::visitUnaryOperationExpression(UnaryOperationExpression* node)
+{
+    visit(node->expression());
+}
+
+void Binder::visitBinaryOperationExpression(BinaryOperationExpression* node)
+{
+    visit(node->left());
+    visit(node->right());
+}
+
+void Binder::visitFunctionExpression(FunctionExpression* node)
+{
+    Identifier* identifier = node->identifier()->asIdentifier();
+    int builtin = -1;
+    if (identifier)
+    {
+        builtin = Builtins::Lookup(identifier->name(), identifier->length());
+    }
+    if (builtin < 0)
+    {
+        fail("Unknown function");
+    }
+    else if (Builtins::Arity((Builtins::Id) builtin)
+            != node->arguments().length())
+    {
+        fail("Wrong number of arguments");
+    }
+    node->bind(builtin);
+
+    for (int i = 0; i < node->arguments().length(); i++)
+    {
+        visit(node->arguments()[i]);
+    }
+}
+
+void Binder::visitIdentifier(Identifier* node)
+{
+    if (node->declaredType() != UNKNOWN_TYPE)
+    {
+        declare(node, false);
+    }
+    else
+    {
+        bindIdentifier(node, _scope->declare(node->symbol()));
+    }
+}
+
+void Binder::visitNumber(Number*)
+{
+}
+
+} /* Doppio namespace */
@@ -0,0 +1,69 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_BINDER_H_
+#define DOPPIO_BINDER_H_
+
+#include "ast.h"
+#include "scope.h"
+
+namespace Doppio
+{
+
+// Resolves every Identifier of a tree to a slot of a Scope and every call
+// to a built-in function. After binding, passes over the tree never look
+// at names again.
+//
+// Declarations such as 'int x' or 'const n = 10' declare their variable
+// in the scope, where it is visible to every tree bound in the same scope
+// afterwards. Each identifier is given the type its variable was declared
+// with as its static type.
+class Binder: public AstVisitor<Binder>
+{
+public:
+    explicit Binder(Scope* scope);
+    ~Binder();
+
+    // Returns false if the tree calls an unknown function, calls a
+    // function with the wrong number of arguments, assigns to anything
+    // but a variable or to a constant, or declares a variable differently
+    // than before; error() then describes the first problem found.
+    bool bind(Expression* expression);
+
+    const char* error() const
+    {
+        return _error;
+    }
+
+#define DECLARE_VISIT(type) void visit##type(type* node);
+    EXPRESSION_NODE_LIST(DECLARE_VISIT)
+#undef DECLARE_VISIT
+
+private:
+    Scope* _scope;
+    const char* _error;
+
+    void fail(const char* message);
+    void bindIdentifier(Identifier* node, int slot);
+    void declare(Identifier* node, bool constant);
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_BINDER_H_ */
@@ -0,0 +1,64 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "builtins.h"
+
+namespace Doppio
+{
+
+#define F(name, string, function) string,
+const char* const Builtins::builtinName[NUM_BUILTINS] =
+{ BUILTIN_LIST(F, F) };
+#undef F
+
+#define F1(name, string, function) 1,
+#define F2(name, string, function) 2,
+const int Builtins::builtinArity[NUM_BUILTINS] =
+{ BUILTIN_LIST(F1, F2) };
+#undef F1
+#undef F2
+
+#define F1(name, string, function) function,
+#define F2(name, string, function) NULL,
+const Builtins::Function1 Builtins::builtinFunction1[NUM_BUILTINS] =
+{ BUILTIN_LIST(F1, F2) };
+#undef F1
+#undef F2
+
+#define F1(name, string, function) NULL,
+#define F2(name, string, function) function,
+const Builtins::Function2 Builtins::builtinFunction2[NUM_BUILTINS] =
+{ BUILTIN_LIST(F1, F2) };
+#undef F1
+#undef F2
+
+int Builtins::Lookup(const char* name, size_t length)
+{
+    for (int id = 0; id < NUM_BUILTINS; id++)
+    {
+        if (strlen(builtinName[id]) == length
+                && memcmp(builtinName[id], name, length) == 0)
+        {
+            return id;
+        }
+    }
+    return -1;
+}
+
+} /* Doppio namespace */
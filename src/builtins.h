@@ -0,0 +1,120 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_BUILTINS_H_
+#define DOPPIO_BUILTINS_H_
+
+#include <cmath>
+#include <cstring>
+#include "value.h"
+
+namespace Doppio
+{
+
+// Built-in functions callable from expressions. F1 declares a function of
+// one argument, F2 a function of two. All of them are pure, compute in
+// double precision and return reals.
+#define BUILTIN_LIST(F1, F2)                                              \
+    F1(ABS, "abs", fabs)                                                  \
+    F1(SQRT, "sqrt", sqrt)                                                \
+    F1(EXP, "exp", exp)                                                   \
+    F1(LOG, "log", log)                                                   \
+    F1(LOG10, "log10", log10)                                             \
+    F1(SIN, "sin", sin)                                                   \
+    F1(COS, "cos", cos)                                                   \
+    F1(TAN, "tan", tan)                                                   \
+    F1(ASIN, "asin", asin)                                                \
+    F1(ACOS, "acos", acos)                                                \
+    F1(ATAN, "atan", atan)                                                \
+    F1(SINH, "sinh", sinh)                                                \
+    F1(COSH, "cosh", cosh)                                                \
+    F1(TANH, "tanh", tanh)                                                \
+    F1(FLOOR, "floor", floor)                                             \
+    F1(CEIL, "ceil", ceil)                                                \
+    F2(MIN, "min", fmin)                                                  \
+    F2(MAX, "max", fmax)                                                  \
+    F2(ATAN2, "atan2", atan2)
+
+class Builtins
+{
+public:
+#define F(name, string, function) name,
+    enum Id
+    {
+        BUILTIN_LIST(F, F)NUM_BUILTINS
+    };
+#undef F
+
+    static const int kMaxArity = 2;
+
+    typedef double (*Function1)(double);
+    typedef double (*Function2)(double, double);
+
+    // Returns the built-in with the given name or -1 if there is none.
+    static int Lookup(const char* name, size_t length);
+
+    static const char* Name(Id id)
+    {
+        ASSERT(id < NUM_BUILTINS);
+        return builtinName[id];
+    }
+
+    static int Arity(Id id)
+    {
+        ASSERT(id < NUM_BUILTINS);
+        return builtinArity[id];
+    }
+
+    // Returns the implementation of a one-argument built-in, NULL for
+    // the others.
+    static Function1 Function1Of(Id id)
+    {
+        ASSERT(id < NUM_BUILTINS);
+        return builtinFunction1[id];
+    }
+
+    // Returns the implementation of a two-argument built-in, NULL for
+    // the others.
+    static Function2 Function2Of(Id id)
+    {
+        ASSERT(id < NUM_BUILTINS);
+        return builtinFunction2[id];
+    }
+
+    // Calls the built-in with Arity(id) arguments.
+    static Value Call(Id id, const Value* arguments)
+    {
+        if (builtinArity[id] == 1)
+        {
+            return Value(builtinFunction1[id](arguments[0].real()));
+        }
+        return Value(builtinFunction2[id](arguments[0].real(),
+                arguments[1].real()));
+    }
+
+private:
+    static const char* const builtinName[NUM_BUILTINS];
+    static const int builtinArity[NUM_BUILTINS];
+    static const Function1 builtinFunction1[NUM_BUILTINS];
+    static const Function2 builtinFunction2[NUM_BUILTINS];
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_BUILTINS_H_ */
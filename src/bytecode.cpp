@@ -0,0 +1,104 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <cstdio>
+#include "bytecode.h"
+#include "builtins.h"
+
+namespace Doppio
+{
+
+#define V(name) #name,
+const char* const Instruction::opcodeName[NUM_OPCODES] =
+{ BYTECODE_LIST(V) };
+#undef V
+
+static void printRegister(const Bytecode* bytecode, int reg)
+{
+    if (reg < bytecode->variableCount())
+    {
+        printf("v%d", reg);
+    }
+    else if (reg < bytecode->constantBase())
+    {
+        printf("t%d", reg - bytecode->variableCount());
+    }
+    else
+    {
+        const Value& constant = bytecode->constants()[reg
+                - bytecode->constantBase()];
+        if (constant.isInteger())
+        {
+            printf("#%ld", constant.integer());
+        }
+        else
+        {
+            printf("#%g", constant.real());
+        }
+    }
+}
+
+void Bytecode::print() const
+{
+    for (size_t i = 0; i < _instructions.size(); i++)
+    {
+        const Instruction& instruction = _instructions[i];
+        Instruction::Opcode opcode = (Instruction::Opcode) instruction.opcode;
+        printf("%4d  %-12s", (int) i, Instruction::Name(opcode));
+        switch (opcode)
+        {
+        case Instruction::RETURN:
+            printRegister(this, instruction.a);
+            break;
+        case Instruction::FACTORIAL:
+        case Instruction::TO_INTEGER:
+        case Instruction::TO_REAL:
+        case Instruction::ASSIGN:
+        case Instruction::MOVE:
+            printRegister(this, instruction.dst);
+            printf(", ");
+            printRegister(this, instruction.a);
+            break;
+        case Instruction::CALL1:
+            printRegister(this, instruction.dst);
+            printf(", %s(", Builtins::Name((Builtins::Id) instruction.builtin));
+            printRegister(this, instruction.a);
+            printf(")");
+            break;
+        case Instruction::CALL2:
+            printRegister(this, instruction.dst);
+            printf(", %s(", Builtins::Name((Builtins::Id) instruction.builtin));
+            printRegister(this, instruction.a);
+            printf(", ");
+            printRegister(this, instruction.b);
+            printf(")");
+            break;
+        default:
+            printRegister(this, instruction.dst);
+            printf(", ");
+            printRegister(this, instruction.a);
+            printf(", ");
+            printRegister(this, instruction.b);
+            break;
+        }
+        printf("\n");
+    }
+}
+
+} /* Doppio namespace */
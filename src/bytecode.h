@@ -0,0 +1,183 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_BYTECODE_H_
+#define DOPPIO_BYTECODE_H_
+
+#include <stdint.h>
+#include <vector>
+#include "value.h"
+
+namespace Doppio
+{
+
+// Register machine instructions. Operands are register numbers; the
+// register file of a program is laid out as
+//
+//   [ variables | temporaries | constants ]
+//
+// so identifiers and literals are operands in place and never need an
+// instruction of their own.
+//
+// The generic arithmetic instructions follow the tags of their operands
+// like Value does. Where TypeInference knows the types of both operands
+// the compiler emits a typed instruction instead, which reads the
+// registers without looking at their tags.
+#define BYTECODE_LIST(V)                                                  \
+    /* dst = a op b */                                                    \
+    V(ADD)                                                                \
+    V(SUB)                                                                \
+    V(MUL)                                                                \
+    V(DIV)                                                                \
+    V(MOD)                                                                \
+    V(POW)                                                                \
+    /* dst = a op b for integers; the divisor of MOD_INTEGER is a */      \
+    /* non-zero constant */                                               \
+    V(ADD_INTEGER)                                                        \
+    V(SUB_INTEGER)                                                        \
+    V(MUL_INTEGER)                                                        \
+    V(MOD_INTEGER)                                                        \
+    /* dst = a op b for reals */                                          \
+    V(ADD_REAL)                                                           \
+    V(SUB_REAL)                                                           \
+    V(MUL_REAL)                                                           \
+    V(DIV_REAL)                                                           \
+    V(MOD_REAL)                                                           \
+    V(POW_REAL)                                                           \
+    /* dst = a! */                                                        \
+    V(FACTORIAL)                                                          \
+    /* dst = a converted to an integer or a real */                       \
+    V(TO_INTEGER)                                                         \
+    V(TO_REAL)                                                            \
+    /* dst = a, where dst is a variable register */                       \
+    V(ASSIGN)                                                             \
+    /* dst = a, where dst is a temporary register */                      \
+    V(MOVE)                                                               \
+    /* dst = builtin(a) and dst = builtin(a, b) */                        \
+    V(CALL1)                                                              \
+    V(CALL2)                                                              \
+    /* return a */                                                        \
+    V(RETURN)
+
+struct Instruction
+{
+#define V(name) name,
+    enum Opcode
+    {
+        BYTECODE_LIST(V)NUM_OPCODES
+    };
+#undef V
+
+    uint8_t opcode;
+    // Builtins::Id for CALL1 and CALL2.
+    uint8_t builtin;
+    uint16_t dst;
+    uint16_t a;
+    uint16_t b;
+
+    static const char* Name(Opcode opcode)
+    {
+        ASSERT(opcode < NUM_OPCODES);
+        return opcodeName[opcode];
+    }
+
+private:
+    static const char* const opcodeName[NUM_OPCODES];
+};
+
+// A compiled expression. Bytecode is immutable once compiled and may be
+// shared by any number of interpreters, including across threads.
+class Bytecode
+{
+public:
+    Bytecode() :
+            _variableCount(0), _registerCount(0)
+    {
+    }
+
+    const std::vector<Instruction>& instructions() const
+    {
+        return _instructions;
+    }
+
+    // Constants occupy the last registers of the register file.
+    const std::vector<Value>& constants() const
+    {
+        return _constants;
+    }
+
+    int constantBase() const
+    {
+        return _registerCount - (int) _constants.size();
+    }
+
+    int variableCount() const
+    {
+        return _variableCount;
+    }
+
+    // The declared type of a variable. Values of typed variables are
+    // converted to their type when a program starts.
+    StaticType variableType(int slot) const
+    {
+        return _variableTypes[slot];
+    }
+
+    int registerCount() const
+    {
+        return _registerCount;
+    }
+
+    // The variables whose registers the program reads and those it
+    // assigns to, in slot order. Evaluating the program against an
+    // environment loads and stores only these.
+    const std::vector<int>& readVariables() const
+    {
+        return _readVariables;
+    }
+
+    const std::vector<int>& assignedVariables() const
+    {
+        return _assignedVariables;
+    }
+
+    // Whether the program writes to any variable register.
+    bool hasAssignments() const
+    {
+        return !_assignedVariables.empty();
+    }
+
+    // Prints the instructions to stdout.
+    void print() const;
+
+private:
+    friend class BytecodeCompiler;
+
+    std::vector<Instruction> _instructions;
+    std::vector<Value> _constants;
+    std::vector<StaticType> _variableTypes;
+    std::vector<int> _readVariables;
+    std::vector<int> _assignedVariables;
+    int _variableCount;
+    int _registerCount;
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_BYTECODE_H_ */
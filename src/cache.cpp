@@ -0,0 +1,361 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include "cache.h"
+#include "binder.h"
+#include "builtins.h"
+#include "compiler.h"
+#include "parser.h"
+
+namespace Doppio
+{
+
+namespace
+{
+
+// Serializes a bound tree into a string that is equal for trees that
+// compute the same value the same way. Operands of '+' and '*' are put in
+// a fixed order, which is exact in both integer and IEEE arithmetic, as
+// long as neither operand assigns to a variable.
+class Canonicalizer: public AstVisitor<Canonicalizer>
+{
+public:
+    Canonicalizer() :
+            _assigns(false)
+    {
+    }
+
+    std::string canonicalize(Expression* expression)
+    {
+        visit(expression);
+        return _result;
+    }
+
+    void visitAssignmentExpression(AssignmentExpression* node)
+    {
+        // declarations differ from plain assignments, and typed targets
+        // convert the value they store
+        visit(node->target());
+        std::string target = _result;
+        visit(node->value());
+        _result = "(" + std::string(Token::String(node->operation())) + " "
+                + target + " " + _result + ")";
+        _assigns = true;
+    }
+
+    void visitUnaryOperationExpression(UnaryOperationExpression* node)
+    {
+        visit(node->expression());
+        _result = "(! " + _result + ")";
+    }
+
+    void visitBinaryOperationExpression(
+            BinaryOperationExpression* node)
+    {
+        _assigns = false;
+        visit(node->left());
+        std::string left = _result;
+        bool leftAssigns = _assigns;
+
+        _assigns = false;
+        visit(node->right());
+        std::string right = _result;
+        bool rightAssigns = _assigns;
+
+        Token::Type operation = node->operation();
+        bool commutative = operation == Token::ADD || operation == Token::MUL;
+        if (commutative && !leftAssigns && !rightAssigns && right < left)
+        {
+            left.swap(right);
+        }
+        _result = "(" + std::string(Token::String(operation)) + " " + left
+                + " " + right + ")";
+        _assigns = leftAssigns || rightAssigns;
+    }
+
+    void visitFunctionExpression(FunctionExpression* node)
+    {
+        bool assigns = false;
+        std::string result = "(";
+        result += Builtins::Name((Builtins::Id) node->builtin());
+        for (int i = 0; i < node->arguments().length(); i++)
+        {
+            _assigns = false;
+            visit(node->arguments()[i]);
+            result += " " + _result;
+            assigns = assigns || _assigns;
+        }
+        _result = result + ")";
+        _assigns = assigns;
+    }
+
+    void visitIdentifier(Identifier* node)
+    {
+        // typed variables are converted as they are read
+        _result.assign(node->name(), node->length());
+        if (node->staticType() == INTEGER_TYPE)
+        {
+            _result += ":int";
+        }
+        else if (node->staticType() == REAL_TYPE)
+        {
+            _result += ":real";
+        }
+        _assigns = false;
+    }
+
+    void visitNumber(Number* node)
+    {
+        // integers and reals never compare equal, and reals are printed
+        // exactly
+        char buffer[64];
+        if (node->type() == Token::NUMBER_INTEGER)
+        {
+            snprintf(buffer, sizeof(buffer), "%ld", node->integer());
+        }
+        else
+        {
+            snprintf(buffer, sizeof(buffer), "%a", node->real());
+        }
+        _result = buffer;
+        _assigns = false;
+    }
+
+private:
+    std::string _result;
+    bool _assigns;
+};
+
+} /* anonymous namespace */
+
+CachedExpression::CachedExpression(Bytecode* bytecode, const Scope& scope) :
+        _bytecode(bytecode), _scope(scope)
+{
+    _memoryUsage = sizeof(*this) + sizeof(Bytecode)
+            + bytecode->instructions().size() * sizeof(Instruction)
+            + bytecode->constants().size() * sizeof(Value);
+    for (int slot = 0; slot < scope.variableCount(); slot++)
+    {
+        // a map node and a vector element per variable
+        _memoryUsage += 2 * (sizeof(std::string) + strlen(
+                scope.variableName(slot))) + 4 * sizeof(void*);
+    }
+}
+
+CachedExpression::~CachedExpression()
+{
+    delete _bytecode;
+}
+
+ExpressionCache::ExpressionCache(size_t memoryLimit) :
+        _memoryLimit(memoryLimit), _memoryUsage(0)
+{
+    memset(&_statistics, 0, sizeof(_statistics));
+}
+
+ExpressionCache::~ExpressionCache()
+{
+    clear();
+}
+
+// 64-bit FNV-1a.
+uint64_t ExpressionCache::hash(const char* source, size_t length)
+{
+    uint64_t result = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++)
+    {
+        result ^= (unsigned char) source[i];
+        result *= 1099511628211ULL;
+    }
+    return result;
+}
+
+std::shared_ptr<const CachedExpression> ExpressionCache::lookup(
+        const char* source, size_t length)
+{
+    uint64_t sourceHash = hash(source, length);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        Entry* entry = findSource(sourceHash, source, length);
+        if (entry)
+        {
+            _statistics.hits++;
+            touch(entry);
+            return entry->expression;
+        }
+    }
+
+    // parse, bind and compile without holding the lock
+    Zone zone;
+    Scope scope;
+    Parser parser(source, length, &zone);
+    Expression* expression = parser.parse().expression;
+    Binder binder(&scope);
+    if (expression == NULL || !binder.bind(expression))
+    {
+        return std::shared_ptr<const CachedExpression>();
+    }
+    std::string canonical = Canonicalizer().canonicalize(expression);
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        CanonicalIndex::iterator it = _canonicals.find(canonical);
+        if (it != _canonicals.end())
+        {
+            return share(it->second, sourceHash, source, length);
+        }
+    }
+
+    Bytecode* bytecode = BytecodeCompiler().compile(expression, &scope);
+    if (bytecode == NULL)
+    {
+        return std::shared_ptr<const CachedExpression>();
+    }
+    std::shared_ptr<const CachedExpression> compiled(new CachedExpression(
+            bytecode, scope));
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    CanonicalIndex::iterator it = _canonicals.find(canonical);
+    if (it != _canonicals.end())
+    {
+        // another thread compiled the same formula meanwhile
+        return share(it->second, sourceHash, source, length);
+    }
+
+    _statistics.misses++;
+    Entry* entry = new Entry();
+    entry->expression = compiled;
+    entry->canonical = canonical;
+    entry->memoryUsage = sizeof(Entry) + compiled->memoryUsage()
+            + canonical.size();
+    _memoryUsage += entry->memoryUsage;
+    _lru.push_front(entry);
+    entry->lru = _lru.begin();
+    _canonicals[canonical] = entry;
+    addAlias(entry, sourceHash, source, length);
+    evict();
+    return compiled;
+}
+
+ExpressionCache::Statistics ExpressionCache::statistics() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Statistics statistics = _statistics;
+    statistics.entries = _lru.size();
+    statistics.memoryUsage = _memoryUsage;
+    return statistics;
+}
+
+void ExpressionCache::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    while (!_lru.empty())
+    {
+        remove(_lru.back());
+    }
+}
+
+ExpressionCache::Entry* ExpressionCache::findSource(uint64_t hash,
+        const char* source, size_t length) const
+{
+    std::pair<SourceIndex::const_iterator, SourceIndex::const_iterator> range =
+            _sources.equal_range(hash);
+    for (SourceIndex::const_iterator it = range.first; it != range.second;
+            ++it)
+    {
+        const std::string& candidate = it->second->source;
+        if (candidate.size() == length
+                && memcmp(candidate.data(), source, length) == 0)
+        {
+            return it->second->entry;
+        }
+    }
+    return NULL;
+}
+
+std::shared_ptr<const CachedExpression> ExpressionCache::share(Entry* entry,
+        uint64_t hash, const char* source, size_t length)
+{
+    _statistics.canonicalHits++;
+    if (!findSource(hash, source, length))
+    {
+        addAlias(entry, hash, source, length);
+    }
+    touch(entry);
+    evict();
+    return entry->expression;
+}
+
+void ExpressionCache::addAlias(Entry* entry, uint64_t hash,
+        const char* source, size_t length)
+{
+    Alias* alias = new Alias();
+    alias->source.assign(source, length);
+    alias->entry = entry;
+    entry->aliases.push_back(alias);
+    _sources.insert(std::make_pair(hash, alias));
+
+    size_t memoryUsage = sizeof(Alias) + length + 4 * sizeof(void*);
+    entry->memoryUsage += memoryUsage;
+    _memoryUsage += memoryUsage;
+}
+
+void ExpressionCache::touch(Entry* entry)
+{
+    _lru.splice(_lru.begin(), _lru, entry->lru);
+}
+
+void ExpressionCache::evict()
+{
+    // the most recently used entry always stays
+    while (_memoryUsage > _memoryLimit && _lru.size() > 1)
+    {
+        remove(_lru.back());
+        _statistics.evictions++;
+    }
+}
+
+void ExpressionCache::remove(Entry* entry)
+{
+    for (std::list<Alias*>::iterator alias = entry->aliases.begin();
+            alias != entry->aliases.end(); ++alias)
+    {
+        uint64_t sourceHash = hash((*alias)->source.data(),
+                (*alias)->source.size());
+        std::pair<SourceIndex::iterator, SourceIndex::iterator> range =
+                _sources.equal_range(sourceHash);
+        for (SourceIndex::iterator it = range.first; it != range.second; ++it)
+        {
+            if (it->second == *alias)
+            {
+                _sources.erase(it);
+                break;
+            }
+        }
+        delete *alias;
+    }
+    _canonicals.erase(entry->canonical);
+    _lru.erase(entry->lru);
+    _memoryUsage -= entry->memoryUsage;
+    delete entry;
+}
+
+} /* Doppio namespace */
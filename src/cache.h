@@ -0,0 +1,161 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_CACHE_H_
+#define DOPPIO_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "bytecode.h"
+#include "scope.h"
+
+namespace Doppio
+{
+
+// A formula compiled by the ExpressionCache. It is immutable and may be
+// used from any number of threads, each with its own Interpreter. Because
+// formulas that differ only in the order of commutative operands share one
+// entry, variables must be looked up by name in scope() rather than
+// assumed to be numbered in source order.
+class CachedExpression
+{
+public:
+    CachedExpression(Bytecode* bytecode, const Scope& scope);
+    ~CachedExpression();
+
+    const Bytecode* bytecode() const
+    {
+        return _bytecode;
+    }
+
+    const Scope& scope() const
+    {
+        return _scope;
+    }
+
+    // Approximate number of bytes held by the entry.
+    size_t memoryUsage() const
+    {
+        return _memoryUsage;
+    }
+
+private:
+    Bytecode* _bytecode;
+    Scope _scope;
+    size_t _memoryUsage;
+
+    // Cached expressions are not copyable.
+    CachedExpression(const CachedExpression&);
+    CachedExpression& operator=(const CachedExpression&);
+};
+
+// Thread-safe LRU cache of compiled formulas in front of the parser and
+// the bytecode compiler.
+//
+// A lookup first hashes the raw source bytes. On a miss the source is
+// parsed and bound, and the tree is reduced to a canonical form in which
+// the operands of '+' and '*' are sorted (when neither side assigns); if
+// an entry with the same canonical form exists it is reused and the new
+// source becomes another key for it, so "a+b" and "b + a" share one
+// program. Only a real miss compiles.
+//
+// Entries are evicted least recently used first once the memory used by
+// entries and keys exceeds the limit given to the constructor.
+class ExpressionCache
+{
+public:
+    struct Statistics
+    {
+        // Lookups answered from the raw source.
+        size_t hits;
+        // Lookups answered from the canonical form after a parse.
+        size_t canonicalHits;
+        // Lookups that compiled a new program.
+        size_t misses;
+        size_t evictions;
+        size_t entries;
+        size_t memoryUsage;
+    };
+
+    explicit ExpressionCache(size_t memoryLimit);
+    ~ExpressionCache();
+
+    // Returns the compiled formula or NULL if the source does not parse,
+    // bind or compile, e.g. because it calls an unknown function or has
+    // more constants than bytecode can address. The entry stays valid for
+    // as long as the caller holds it, even if it is evicted meanwhile.
+    std::shared_ptr<const CachedExpression> lookup(const char* source,
+            size_t length);
+
+    Statistics statistics() const;
+
+    void clear();
+
+private:
+    struct Entry;
+
+    struct Alias
+    {
+        std::string source;
+        Entry* entry;
+    };
+
+    struct Entry
+    {
+        std::shared_ptr<const CachedExpression> expression;
+        std::string canonical;
+        std::list<Alias*> aliases;
+        std::list<Entry*>::iterator lru;
+        size_t memoryUsage;
+    };
+
+    typedef std::unordered_multimap<uint64_t, Alias*> SourceIndex;
+    typedef std::unordered_map<std::string, Entry*> CanonicalIndex;
+
+    mutable std::mutex _mutex;
+    size_t _memoryLimit;
+    size_t _memoryUsage;
+    SourceIndex _sources;
+    CanonicalIndex _canonicals;
+    // Most recently used first.
+    std::list<Entry*> _lru;
+    Statistics _statistics;
+
+    static uint64_t hash(const char* source, size_t length);
+
+    Entry* findSource(uint64_t hash, const char* source, size_t length) const;
+    std::shared_ptr<const CachedExpression> share(Entry* entry, uint64_t hash,
+            const char* source, size_t length);
+    void addAlias(Entry* entry, uint64_t hash, const char* source,
+            size_t length);
+    void touch(Entry* entry);
+    void evict();
+    void remove(Entry* entry);
+
+    // Caches are not copyable.
+    ExpressionCache(const ExpressionCache&);
+    ExpressionCache& operator=(const ExpressionCache&);
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_CACHE_H_ */
@@ -0,0 +1,485 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <cstring>
+#include "compiler.h"
+#include "stats.h"
+#include "typing.h"
+
+namespace Doppio
+{
+
+namespace
+{
+
+// Counts the parents of every node of a DAG.
+class UseCounter: public AstVisitor<UseCounter>
+{
+public:
+    explicit UseCounter(std::unordered_map<Expression*, int>* uses) :
+            _uses(uses)
+    {
+    }
+
+    void count(Expression* node)
+    {
+        if ((*_uses)[node]++ == 0)
+        {
+            visit(node);
+        }
+    }
+
+    void visitAssignmentExpression(AssignmentExpression* node)
+    {
+        count(node->value());
+    }
+
+    void visitUnaryOperationExpression(UnaryOperationExpression* node)
+    {
+        count(node->expression());
+    }
+
+    void visitBinaryOperationExpression(
+            BinaryOperationExpression* node)
+    {
+        count(node->left());
+        count(node->right());
+    }
+
+    void visitFunctionExpression(FunctionExpression* node)
+    {
+        for (int i = 0; i < node->arguments().length(); i++)
+        {
+            count(node->arguments()[i]);
+        }
+    }
+
+    void visitIdentifier(Identifier*)
+    {
+    }
+
+    void visitNumber(Number*)
+    {
+    }
+
+private:
+    std::unordered_map<Expression*, int>* _uses;
+};
+
+} /* anonymous namespace */
+
+BytecodeCompiler::BytecodeCompiler() :
+        _bytecode(NULL), _error(NULL), _result(0), _temporaryTop(0), _temporaryCount(0),
+        _sharedCount(0), _node(NULL), _sourceNodes(NULL)
+{
+}
+
+BytecodeCompiler::~BytecodeCompiler()
+{
+}
+
+Bytecode* BytecodeCompiler::compile(Expression* expression,
+        const Scope* scope)
+{
+    StatsTimer timer(COMPILE_STAGE);
+    _error = NULL;
+    _bytecode = new Bytecode();
+    if (scope->variableCount() >= kSharedTag)
+    {
+        return fail("too many variables");
+    }
+    _bytecode->_variableCount = scope->variableCount();
+    for (int slot = 0; slot < scope->variableCount(); slot++)
+    {
+        _bytecode->_variableTypes.push_back(scope->variableType(slot));
+    }
+    _temporaryTop = 0;
+    _temporaryCount = 0;
+    _sharedCount = 0;
+    _uses.clear();
+    _shared.clear();
+    _node = NULL;
+    if (_sourceNodes)
+    {
+        _sourceNodes->clear();
+    }
+    UseCounter(&_uses).count(expression);
+    TypeInference().infer(expression);
+
+    int result = compileOperand(expression);
+    emit(Instruction::RETURN, 0, result);
+
+    // relocate shared registers and constants behind the temporaries;
+    // tags that overflowed into each other are caught here, before the
+    // instructions are read again
+    int sharedBase = _bytecode->_variableCount + _temporaryCount;
+    int constantBase = sharedBase + _sharedCount;
+    if (sharedBase >= kSharedTag || _sharedCount >= kSharedTag)
+    {
+        return fail("too many temporary registers");
+    }
+    if (_bytecode->_constants.size() >= (size_t) kConstantTag
+            || constantBase + _bytecode->_constants.size() > 0x10000)
+    {
+        return fail("too many constants");
+    }
+    std::vector<Instruction>& code = _bytecode->_instructions;
+    for (size_t i = 0; i < code.size(); i++)
+    {
+        uint16_t* operands[] = { &code[i].dst, &code[i].a, &code[i].b };
+        for (int j = 0; j < 3; j++)
+        {
+            if (*operands[j] >= kConstantTag)
+            {
+                *operands[j] = *operands[j] - kConstantTag + constantBase;
+            }
+            else if (*operands[j] >= kSharedTag)
+            {
+                *operands[j] = *operands[j] - kSharedTag + sharedBase;
+            }
+        }
+    }
+    _bytecode->_registerCount = constantBase + _bytecode->_constants.size();
+    findVariables();
+
+    Bytecode* bytecode = _bytecode;
+    _bytecode = NULL;
+    return bytecode;
+}
+
+Bytecode* BytecodeCompiler::fail(const char* message)
+{
+    _error = message;
+    delete _bytecode;
+    _bytecode = NULL;
+    return NULL;
+}
+
+// Lists the variable registers the instructions read and assign.
+void BytecodeCompiler::findVariables()
+{
+    int variableCount = _bytecode->_variableCount;
+    std::vector<bool> read(variableCount);
+    std::vector<bool> assigned(variableCount);
+    const std::vector<Instruction>& code = _bytecode->_instructions;
+    for (size_t i = 0; i < code.size(); i++)
+    {
+        bool binary = true;
+        switch (code[i].opcode)
+        {
+        case Instruction::ASSIGN:
+            assigned[code[i].dst] = true;
+            binary = false;
+            break;
+        case Instruction::FACTORIAL:
+        case Instruction::TO_INTEGER:
+        case Instruction::TO_REAL:
+        case Instruction::MOVE:
+        case Instruction::CALL1:
+        case Instruction::RETURN:
+            binary = false;
+            break;
+        default:
+            break;
+        }
+        if (code[i].a < variableCount)
+        {
+            read[code[i].a] = true;
+        }
+        if (binary && code[i].b < variableCount)
+        {
+            read[code[i].b] = true;
+        }
+    }
+    for (int slot = 0; slot < variableCount; slot++)
+    {
+        if (read[slot])
+        {
+            _bytecode->_readVariables.push_back(slot);
+        }
+        if (assigned[slot])
+        {
+            _bytecode->_assignedVariables.push_back(slot);
+        }
+    }
+}
+
+int BytecodeCompiler::compileOperand(Expression* node)
+{
+    if (!_shared.empty())
+    {
+        std::unordered_map<Expression*, int>::const_iterator it =
+                _shared.find(node);
+        if (it != _shared.end())
+        {
+            return it->second;
+        }
+    }
+    const Expression* parent = _node;
+    _node = node;
+    visit(node);
+    _node = parent;
+    return _result;
+}
+
+// Returns the register for the value of node: a register of its own if
+// the node has several parents, the next temporary otherwise.
+int BytecodeCompiler::destination(Expression* node)
+{
+    if (_uses[node] > 1)
+    {
+        int reg = kSharedTag + _sharedCount++;
+        _shared[node] = reg;
+        return reg;
+    }
+    return allocateTemporary();
+}
+
+int BytecodeCompiler::allocateTemporary()
+{
+    int temporary = _temporaryTop++;
+    if (_temporaryTop > _temporaryCount)
+    {
+        _temporaryCount = _temporaryTop;
+    }
+    return _bytecode->_variableCount + temporary;
+}
+
+// Constants are shared only if they are bitwise equal, so that 0 and -0
+// or 0 and 0.0 keep their own registers.
+static bool isSameConstant(const Value& x, const Value& y)
+{
+    if (x.type() != y.type())
+    {
+        return false;
+    }
+    if (x.isInteger())
+    {
+        return x.integer() == y.integer();
+    }
+    double a = x.real();
+    double b = y.real();
+    return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+int BytecodeCompiler::addConstant(const Value& value)
+{
+    std::vector<Value>& constants = _bytecode->_constants;
+    for (size_t i = 0; i < constants.size(); i++)
+    {
+        if (isSameConstant(constants[i], value))
+        {
+            return kConstantTag + i;
+        }
+    }
+    constants.push_back(value);
+    return kConstantTag + constants.size() - 1;
+}
+
+// Returns a register holding the value of node, computed into reg, as a
+// value of the given type. Constants are converted at compile time.
+int BytecodeCompiler::convert(Expression* node, int reg, StaticType type)
+{
+    if (node->staticType() == type)
+    {
+        return reg;
+    }
+    if (node->asNumber())
+    {
+        return addConstant(node->asNumber()->value().convertTo(type));
+    }
+    int result = allocateTemporary();
+    emit(type == INTEGER_TYPE ? Instruction::TO_INTEGER : Instruction::TO_REAL,
+            result, reg);
+    return result;
+}
+
+// Operands are read when their instruction executes, not when they are
+// compiled. A variable used as the left operand must therefore be copied
+// before the right operand's code runs if that code assigns to it, as in
+// x + (x = 1).
+int BytecodeCompiler::protect(int reg, size_t mark)
+{
+    if (reg >= _bytecode->_variableCount)
+    {
+        return reg;
+    }
+    std::vector<Instruction>& code = _bytecode->_instructions;
+    for (size_t i = mark; i < code.size(); i++)
+    {
+        if (code[i].opcode == Instruction::ASSIGN && code[i].dst == reg)
+        {
+            // the copy lives in a fresh temporary that none of the
+            // instructions after the mark uses
+            int copy = _bytecode->_variableCount + _temporaryCount++;
+            // conversions of the operands come after the copy
+            _temporaryTop = _temporaryCount;
+            Instruction move = { Instruction::MOVE, 0, (uint16_t) copy,
+                    (uint16_t) reg, 0 };
+            code.insert(code.begin() + mark, move);
+            if (_sourceNodes)
+            {
+                _sourceNodes->insert(_sourceNodes->begin() + mark, _node);
+            }
+            return copy;
+        }
+    }
+    return reg;
+}
+
+void BytecodeCompiler::emit(Instruction::Opcode opcode, int dst, int a, int b,
+        int builtin)
+{
+    Instruction instruction = { (uint8_t) opcode, (uint8_t) builtin,
+            (uint16_t) dst, (uint16_t) a, (uint16_t) b };
+    _bytecode->_instructions.push_back(instruction);
+    if (_sourceNodes)
+    {
+        _sourceNodes->push_back(_node);
+    }
+}
+
+void BytecodeCompiler::visitAssignmentExpression(AssignmentExpression* node)
+{
+    int value = compileOperand(node->value());
+    Identifier* target = node->target()->asIdentifier();
+    if (target->staticType() != UNKNOWN_TYPE)
+    {
+        value = convert(node->value(), value, target->staticType());
+    }
+    int slot = target->slot();
+    emit(Instruction::ASSIGN, slot, value);
+    _result = slot;
+}
+
+void BytecodeCompiler::visitUnaryOperationExpression(
+        UnaryOperationExpression* node)
+{
+    ASSERT(node->operation() == Token::FACTORIAL);
+    int mark = _temporaryTop;
+    int operand = compileOperand(node->expression());
+    _temporaryTop = mark;
+    _result = destination(node);
+    emit(Instruction::FACTORIAL, _result, operand);
+}
+
+void BytecodeCompiler::visitBinaryOperationExpression(
+        BinaryOperationExpression* node)
+{
+    // the generic, integer and real forms of the operation
+    Instruction::Opcode opcode;
+    Instruction::Opcode integerOpcode = Instruction::NUM_OPCODES;
+    Instruction::Opcode realOpcode;
+    switch (node->operation())
+    {
+    case Token::ADD:
+        opcode = Instruction::ADD;
+        integerOpcode = Instruction::ADD_INTEGER;
+        realOpcode = Instruction::ADD_REAL;
+        break;
+    case Token::SUB:
+        opcode = Instruction::SUB;
+        integerOpcode = Instruction::SUB_INTEGER;
+        realOpcode = Instruction::SUB_REAL;
+        break;
+    case Token::MUL:
+        opcode = Instruction::MUL;
+        integerOpcode = Instruction::MUL_INTEGER;
+        realOpcode = Instruction::MUL_REAL;
+        break;
+    case Token::DIV:
+        opcode = Instruction::DIV;
+        realOpcode = Instruction::DIV_REAL;
+        break;
+    case Token::MOD:
+        opcode = Instruction::MOD;
+        integerOpcode = Instruction::MOD_INTEGER;
+        realOpcode = Instruction::MOD_REAL;
+        break;
+    case Token::POW:
+        opcode = Instruction::POW;
+        realOpcode = Instruction::POW_REAL;
+        break;
+    default:
+        ASSERT(false);
+        return;
+    }
+
+    int mark = _temporaryTop;
+    int left = compileOperand(node->left());
+    size_t code = _bytecode->_instructions.size();
+    int right = compileOperand(node->right());
+    left = protect(left, code);
+
+    StaticType leftType = node->left()->staticType();
+    StaticType rightType = node->right()->staticType();
+    if (node->staticType() == INTEGER_TYPE)
+    {
+        ASSERT(leftType == INTEGER_TYPE && rightType == INTEGER_TYPE);
+        opcode = integerOpcode;
+    }
+    else if (node->staticType() == REAL_TYPE && leftType != UNKNOWN_TYPE
+            && rightType != UNKNOWN_TYPE)
+    {
+        opcode = realOpcode;
+        left = convert(node->left(), left, REAL_TYPE);
+        right = convert(node->right(), right, REAL_TYPE);
+    }
+    _temporaryTop = mark;
+    _result = destination(node);
+    emit(opcode, _result, left, right);
+}
+
+void BytecodeCompiler::visitFunctionExpression(FunctionExpression* node)
+{
+    ASSERT(node->builtin() >= 0);
+    const ZoneList<Expression*>& arguments = node->arguments();
+    int mark = _temporaryTop;
+    if (arguments.length() == 1)
+    {
+        int a = compileOperand(arguments[0]);
+        _temporaryTop = mark;
+        _result = destination(node);
+        emit(Instruction::CALL1, _result, a, 0, node->builtin());
+    }
+    else
+    {
+        ASSERT(arguments.length() == 2);
+        int a = compileOperand(arguments[0]);
+        size_t code = _bytecode->_instructions.size();
+        int b = compileOperand(arguments[1]);
+        a = protect(a, code);
+        _temporaryTop = mark;
+        _result = destination(node);
+        emit(Instruction::CALL2, _result, a, b, node->builtin());
+    }
+}
+
+void BytecodeCompiler::visitIdentifier(Identifier* node)
+{
+    ASSERT(node->slot() >= 0);
+    _result = node->slot();
+}
+
+void BytecodeCompiler::visitNumber(Number* node)
+{
+    _result = addConstant(node->value());
+}
+
+} /* Doppio namespace */
@@ -0,0 +1,103 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_COMPILER_H_
+#define DOPPIO_COMPILER_H_
+
+#include <unordered_map>
+#include "ast.h"
+#include "bytecode.h"
+#include "scope.h"
+
+namespace Doppio
+{
+
+// Lowers a bound expression tree to register machine Bytecode. Every
+// operation becomes one instruction whose operands name variable, constant
+// or temporary registers directly; temporaries are reused in stack order.
+// Nodes with more than one parent, as produced by SubexpressionSharing,
+// are computed once into a register of their own. Operations whose
+// operand types TypeInference knows become typed instructions.
+class BytecodeCompiler: public AstVisitor<BytecodeCompiler>
+{
+public:
+    BytecodeCompiler();
+    ~BytecodeCompiler();
+
+    // Compiles a tree bound by a Binder in scope. The caller owns the
+    // returned bytecode. Returns NULL if the program needs more registers
+    // or constants than instructions can address; error() then describes
+    // the limit.
+    Bytecode* compile(Expression* expression, const Scope* scope);
+
+    const char* error() const
+    {
+        return _error;
+    }
+
+    // Makes compile() fill nodes with the node that each instruction
+    // belongs to, NULL for the final RETURN, so that a Profile can be
+    // mapped back to the tree and its SourceMap. Conversions and copies of
+    // operands belong to the operation that needs them. The vector must
+    // outlive the compiler.
+    void setSourceNodes(std::vector<const Expression*>* nodes)
+    {
+        _sourceNodes = nodes;
+    }
+
+#define DECLARE_VISIT(type) void visit##type(type* node);
+    EXPRESSION_NODE_LIST(DECLARE_VISIT)
+#undef DECLARE_VISIT
+
+private:
+    // While compiling, registers of shared nodes are numbered from
+    // kSharedTag and constants from kConstantTag; both are moved behind the
+    // temporaries once the number of temporaries is known.
+    static const int kSharedTag = 0x4000;
+    static const int kConstantTag = 0x8000;
+
+    Bytecode* _bytecode;
+    const char* _error;
+    int _result;
+    int _temporaryTop;
+    int _temporaryCount;
+    int _sharedCount;
+    std::unordered_map<Expression*, int> _uses;
+    std::unordered_map<Expression*, int> _shared;
+
+    // The node being compiled, and where to record it, see
+    // setSourceNodes().
+    const Expression* _node;
+    std::vector<const Expression*>* _sourceNodes;
+
+    int compileOperand(Expression* node);
+    int allocateTemporary();
+    int destination(Expression* node);
+    int addConstant(const Value& value);
+    int convert(Expression* node, int reg, StaticType type);
+    int protect(int reg, size_t mark);
+    Bytecode* fail(const char* message);
+    void findVariables();
+    void emit(Instruction::Opcode opcode, int dst, int a, int b = 0,
+            int builtin = 0);
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_COMPILER_H_ */
@@ -0,0 +1,654 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "derivative.h"
+
+namespace Doppio
+{
+
+Differentiator::Differentiator(Zone* zone) :
+        _zone(zone), _slot(-1), _assigns(false), _full(false), _result(NULL)
+{
+}
+
+Differentiator::~Differentiator()
+{
+}
+
+Expression* Differentiator::differentiate(Expression* expression, int slot)
+{
+    _slot = slot;
+    _assigns = false;
+    _full = false;
+    _derivatives.clear();
+    Expression* result = derivative(expression);
+    if (_assigns || _full)
+    {
+        return NULL;
+    }
+    return result ? result : number(0L);
+}
+
+// Differentiates each node of a shared subtree once.
+Expression* Differentiator::derivative(Expression* node)
+{
+    std::unordered_map<Expression*, Expression*>::iterator it =
+            _derivatives.find(node);
+    if (it != _derivatives.end())
+    {
+        return it->second;
+    }
+    visit(node);
+    _derivatives[node] = _result;
+    return _result;
+}
+
+void Differentiator::visitAssignmentExpression(AssignmentExpression*)
+{
+    // a derivative must not assign, and one that ignored the assignment
+    // would read stale variables
+    _assigns = true;
+    _result = NULL;
+}
+
+void Differentiator::visitUnaryOperationExpression(
+        UnaryOperationExpression* node)
+{
+    ASSERT(node->operation() == Token::FACTORIAL);
+    _result = NULL;
+}
+
+void Differentiator::visitBinaryOperationExpression(
+        BinaryOperationExpression* node)
+{
+    Expression* u = node->left();
+    Expression* v = node->right();
+    Expression* du = derivative(u);
+    Expression* dv = derivative(v);
+    switch (node->operation())
+    {
+    case Token::ADD:
+        _result = add(du, dv);
+        break;
+    case Token::SUB:
+        _result = subtract(du, dv);
+        break;
+    case Token::MUL:
+        _result = add(multiply(du, v), multiply(u, dv));
+        break;
+    case Token::DIV:
+        if (dv == NULL)
+        {
+            _result = divide(du, v);
+        }
+        else
+        {
+            _result = divide(subtract(multiply(du, v), multiply(u, dv)),
+                    multiply(v, v));
+        }
+        break;
+    case Token::MOD:
+        _result = subtract(du,
+                multiply(call(Builtins::FLOOR, divide(u, v)), dv));
+        break;
+    case Token::POW:
+        if (dv == NULL)
+        {
+            // v * u^(v - 1) * du
+            _result = multiply(multiply(v, binary(Token::POW, u,
+                    subtract(v, number(1L)))), du);
+        }
+        else
+        {
+            // u^v * (dv * log(u) + v * du / u)
+            _result = multiply(node, add(multiply(dv,
+                    call(Builtins::LOG, u)), divide(multiply(v, du), u)));
+        }
+        break;
+    default:
+        ASSERT(false);
+        break;
+    }
+}
+
+void Differentiator::visitFunctionExpression(FunctionExpression* node)
+{
+    ASSERT(node->builtin() >= 0);
+    Expression* u = node->arguments()[0];
+    Expression* du = derivative(u);
+    Expression* v = NULL;
+    Expression* dv = NULL;
+    if (node->arguments().length() > 1)
+    {
+        v = node->arguments()[1];
+        dv = derivative(v);
+    }
+    if (du == NULL && dv == NULL)
+    {
+        _result = NULL;
+        return;
+    }
+
+    Expression* c;
+    switch ((Builtins::Id) node->builtin())
+    {
+    case Builtins::ABS:
+        _result = multiply(divide(u, call(Builtins::ABS, u)), du);
+        break;
+    case Builtins::SQRT:
+        _result = divide(du, multiply(number(2L), node));
+        break;
+    case Builtins::EXP:
+        _result = multiply(node, du);
+        break;
+    case Builtins::LOG:
+        _result = divide(du, u);
+        break;
+    case Builtins::LOG10:
+        _result = divide(du, multiply(u, number(M_LN10)));
+        break;
+    case Builtins::SIN:
+        _result = multiply(call(Builtins::COS, u), du);
+        break;
+    case Builtins::COS:
+        _result = subtract(NULL, multiply(call(Builtins::SIN, u), du));
+        break;
+    case Builtins::TAN:
+        c = call(Builtins::COS, u);
+        _result = divide(du, multiply(c, c));
+        break;
+    case Builtins::ASIN:
+        _result = divide(du, call(Builtins::SQRT,
+                subtract(number(1L), multiply(u, u))));
+        break;
+    case Builtins::ACOS:
+        _result = subtract(NULL, divide(du, call(Builtins::SQRT,
+                subtract(number(1L), multiply(u, u)))));
+        break;
+    case Builtins::ATAN:
+        _result = divide(du, add(number(1L), multiply(u, u)));
+        break;
+    case Builtins::SINH:
+        _result = multiply(call(Builtins::COSH, u), du);
+        break;
+    case Builtins::COSH:
+        _result = multiply(call(Builtins::SINH, u), du);
+        break;
+    case Builtins::TANH:
+        c = call(Builtins::COSH, u);
+        _result = divide(du, multiply(c, c));
+        break;
+    case Builtins::FLOOR:
+    case Builtins::CEIL:
+        _result = NULL;
+        break;
+    case Builtins::MIN:
+    case Builtins::MAX:
+    {
+        // min(u, v) = (u + v - s (u - v)) / 2 with s the sign of u - v,
+        // whose derivative weighs du by (1 - s) / 2 and dv by (1 + s) / 2,
+        // one of which is 0; max swaps the weights. Weighing each side
+        // keeps a small du from cancelling against a large dv.
+        Expression* difference = subtract(u, v);
+        Expression* sign = divide(difference,
+                call(Builtins::ABS, difference));
+        Expression* lower = divide(subtract(number(1L), sign), number(2L));
+        Expression* upper = divide(add(number(1L), sign), number(2L));
+        if (node->builtin() == Builtins::MIN)
+        {
+            _result = add(multiply(du, lower), multiply(dv, upper));
+        }
+        else
+        {
+            _result = add(multiply(du, upper), multiply(dv, lower));
+        }
+        break;
+    }
+    case Builtins::ATAN2:
+        // d atan2(u, v) = (v du - u dv) / (u^2 + v^2)
+        _result = divide(subtract(multiply(v, du), multiply(u, dv)),
+                add(multiply(u, u), multiply(v, v)));
+        break;
+    default:
+        ASSERT(false);
+        break;
+    }
+}
+
+void Differentiator::visitIdentifier(Identifier* node)
+{
+    ASSERT(node->slot() >= 0);
+    _result = node->slot() == _slot ? number(1L) : NULL;
+}
+
+void Differentiator::visitNumber(Number*)
+{
+    _result = NULL;
+}
+
+Expression* Differentiator::number(long value)
+{
+    return new (_zone) Number(value);
+}
+
+Expression* Differentiator::number(double value)
+{
+    return new (_zone) Number(value);
+}
+
+namespace
+{
+
+bool isOne(Expression* node)
+{
+    Number* number = node->asNumber();
+    return number && number->value().isInteger() && number->integer() == 1;
+}
+
+} /* anonymous namespace */
+
+// The arithmetic helpers take NULL for a derivative that is zero.
+Expression* Differentiator::add(Expression* left, Expression* right)
+{
+    if (left == NULL)
+    {
+        return right;
+    }
+    if (right == NULL)
+    {
+        return left;
+    }
+    return binary(Token::ADD, left, right);
+}
+
+Expression* Differentiator::subtract(Expression* left, Expression* right)
+{
+    if (right == NULL)
+    {
+        return left;
+    }
+    return binary(Token::SUB, left ? left : number(0L), right);
+}
+
+Expression* Differentiator::multiply(Expression* left, Expression* right)
+{
+    if (left == NULL || right == NULL)
+    {
+        return NULL;
+    }
+    if (isOne(left))
+    {
+        return right;
+    }
+    if (isOne(right))
+    {
+        return left;
+    }
+    return binary(Token::MUL, left, right);
+}
+
+Expression* Differentiator::divide(Expression* left, Expression* right)
+{
+    ASSERT(right != NULL);
+    if (left == NULL)
+    {
+        return NULL;
+    }
+    return binary(Token::DIV, left, right);
+}
+
+Expression* Differentiator::binary(Token::Type operation, Expression* left,
+        Expression* right)
+{
+    return new (_zone) BinaryOperationExpression(operation, left, right);
+}
+
+// Returns a bound call of the built-in.
+Expression* Differentiator::call(Builtins::Id id, Expression* argument,
+        Expression* second)
+{
+    ZoneList<Expression*> arguments;
+    arguments.add(argument, _zone);
+    if (second)
+    {
+        arguments.add(second, _zone);
+    }
+    const char* name = Builtins::Name(id);
+    Symbol symbol = SymbolTable::Current()->intern(name, strlen(name));
+    if (symbol == SymbolTable::kNoSymbol)
+    {
+        // the tree is dropped, the node only needs to be valid
+        _full = true;
+        symbol = 0;
+    }
+    Identifier* identifier = new (_zone) Identifier(symbol);
+    FunctionExpression* result = new (_zone) FunctionExpression(identifier,
+            arguments);
+    result->bind(id);
+    return result;
+}
+
+GradientTape::GradientTape(Expression* expression, const Scope* scope) :
+        _variableCount(scope->variableCount()), _result(-1),
+        _variables(scope->variableCount(), -1)
+{
+    record(expression);
+    _variables.clear();
+    _recorded.clear();
+    _values.resize(_entries.size());
+    _adjoints.resize(_entries.size());
+}
+
+GradientTape::~GradientTape()
+{
+}
+
+double GradientTape::evaluate(const double* variables, double* gradient)
+{
+    int length = (int) _entries.size();
+    const Entry* entries = _entries.data();
+    double* values = _values.data();
+    for (int i = 0; i < length; i++)
+    {
+        const Entry& entry = entries[i];
+        if (entry.kind == CONSTANT)
+        {
+            values[i] = entry.value;
+            continue;
+        }
+        if (entry.kind == VARIABLE)
+        {
+            // a is the slot here, not an entry
+            values[i] = variables[entry.a];
+            continue;
+        }
+        double x = values[entry.a];
+        double y = entry.b >= 0 ? values[entry.b] : 0;
+        switch (entry.kind)
+        {
+        case ADD:
+            values[i] = x + y;
+            break;
+        case SUB:
+            values[i] = x - y;
+            break;
+        case MUL:
+            values[i] = x * y;
+            break;
+        case DIV:
+            values[i] = x / y;
+            break;
+        case MOD:
+            values[i] = x - y * floor(x / y);
+            break;
+        case POW:
+            values[i] = pow(x, y);
+            break;
+        case FACTORIAL:
+            values[i] = (double) Value::factorial(Value(x)).integer();
+            break;
+        case CALL1:
+            values[i] = Builtins::Function1Of((Builtins::Id) entry.builtin)(x);
+            break;
+        case CALL2:
+            values[i] = Builtins::Function2Of((Builtins::Id) entry.builtin)(x,
+                    y);
+            break;
+        }
+    }
+
+    double* adjoints = _adjoints.data();
+    memset(adjoints, 0, length * sizeof(double));
+    // gradient may be NULL when there are no variables
+    std::fill(gradient, gradient + _variableCount, 0.0);
+    adjoints[length - 1] = 1;
+    for (int i = length - 1; i >= 0; i--)
+    {
+        const Entry& entry = entries[i];
+        double g = adjoints[i];
+        if (g == 0 || entry.kind == CONSTANT)
+        {
+            continue;
+        }
+        if (entry.kind == VARIABLE)
+        {
+            gradient[entry.a] += g;
+            continue;
+        }
+        double x = values[entry.a];
+        double y = entry.b >= 0 ? values[entry.b] : 0;
+        switch (entry.kind)
+        {
+        case ADD:
+            adjoints[entry.a] += g;
+            adjoints[entry.b] += g;
+            break;
+        case SUB:
+            adjoints[entry.a] += g;
+            adjoints[entry.b] -= g;
+            break;
+        case MUL:
+            adjoints[entry.a] += g * y;
+            adjoints[entry.b] += g * x;
+            break;
+        case DIV:
+            adjoints[entry.a] += g / y;
+            adjoints[entry.b] -= g * values[i] / y;
+            break;
+        case MOD:
+            adjoints[entry.a] += g;
+            adjoints[entry.b] -= g * floor(x / y);
+            break;
+        case POW:
+            adjoints[entry.a] += g * y * pow(x, y - 1);
+            if (entries[entry.b].kind != CONSTANT)
+            {
+                adjoints[entry.b] += g * values[i] * log(x);
+            }
+            break;
+        case FACTORIAL:
+            break;
+        case CALL1:
+        {
+            double d;
+            switch ((Builtins::Id) entry.builtin)
+            {
+            case Builtins::ABS:
+                d = x > 0 ? 1 : x < 0 ? -1 : 0;
+                break;
+            case Builtins::SQRT:
+                d = 0.5 / values[i];
+                break;
+            case Builtins::EXP:
+                d = values[i];
+                break;
+            case Builtins::LOG:
+                d = 1 / x;
+                break;
+            case Builtins::LOG10:
+                d = 1 / (x * M_LN10);
+                break;
+            case Builtins::SIN:
+                d = cos(x);
+                break;
+            case Builtins::COS:
+                d = -sin(x);
+                break;
+            case Builtins::TAN:
+                d = 1 + values[i] * values[i];
+                break;
+            case Builtins::ASIN:
+                d = 1 / sqrt(1 - x * x);
+                break;
+            case Builtins::ACOS:
+                d = -1 / sqrt(1 - x * x);
+                break;
+            case Builtins::ATAN:
+                d = 1 / (1 + x * x);
+                break;
+            case Builtins::SINH:
+                d = cosh(x);
+                break;
+            case Builtins::COSH:
+                d = sinh(x);
+                break;
+            case Builtins::TANH:
+                d = 1 - values[i] * values[i];
+                break;
+            default:
+                // floor and ceil pass nothing back, not even a NaN adjoint
+                continue;
+            }
+            adjoints[entry.a] += g * d;
+            break;
+        }
+        case CALL2:
+            switch ((Builtins::Id) entry.builtin)
+            {
+            case Builtins::MIN:
+                // the argument fmin returned, which skips NaN
+                adjoints[x <= y || y != y ? entry.a : entry.b] += g;
+                break;
+            case Builtins::MAX:
+                adjoints[x >= y || y != y ? entry.a : entry.b] += g;
+                break;
+            default:
+            {
+                // atan2(x, y)
+                double r = x * x + y * y;
+                adjoints[entry.a] += g * y / r;
+                adjoints[entry.b] -= g * x / r;
+                break;
+            }
+            }
+            break;
+        }
+    }
+    return values[length - 1];
+}
+
+void GradientTape::visitAssignmentExpression(AssignmentExpression* node)
+{
+    _result = record(node->value());
+    _variables[node->target()->asIdentifier()->slot()] = _result;
+    // subtrees recorded so far may have read the old value
+    _recorded.clear();
+}
+
+void GradientTape::visitUnaryOperationExpression(
+        UnaryOperationExpression* node)
+{
+    ASSERT(node->operation() == Token::FACTORIAL);
+    _result = emit(FACTORIAL, record(node->expression()));
+}
+
+void GradientTape::visitBinaryOperationExpression(
+        BinaryOperationExpression* node)
+{
+    int a = record(node->left());
+    int b = record(node->right());
+    Kind kind = ADD;
+    switch (node->operation())
+    {
+    case Token::ADD:
+        kind = ADD;
+        break;
+    case Token::SUB:
+        kind = SUB;
+        break;
+    case Token::MUL:
+        kind = MUL;
+        break;
+    case Token::DIV:
+        kind = DIV;
+        break;
+    case Token::MOD:
+        kind = MOD;
+        break;
+    case Token::POW:
+        kind = POW;
+        break;
+    default:
+        ASSERT(false);
+        break;
+    }
+    _result = emit(kind, a, b);
+}
+
+void GradientTape::visitFunctionExpression(FunctionExpression* node)
+{
+    ASSERT(node->builtin() >= 0);
+    int a = record(node->arguments()[0]);
+    if (node->arguments().length() == 1)
+    {
+        _result = emit(CALL1, a, -1, node->builtin());
+    }
+    else
+    {
+        int b = record(node->arguments()[1]);
+        _result = emit(CALL2, a, b, node->builtin());
+    }
+}
+
+void GradientTape::visitIdentifier(Identifier* node)
+{
+    int slot = node->slot();
+    ASSERT(slot >= 0 && slot < _variableCount);
+    if (_variables[slot] < 0)
+    {
+        _variables[slot] = emit(VARIABLE, slot);
+    }
+    _result = _variables[slot];
+}
+
+void GradientTape::visitNumber(Number* node)
+{
+    _result = emit(CONSTANT, -1);
+    _entries.back().value = node->real();
+}
+
+// Records each node of a shared subtree once.
+int GradientTape::record(Expression* node)
+{
+    std::unordered_map<Expression*, int>::iterator it = _recorded.find(node);
+    if (it != _recorded.end())
+    {
+        return it->second;
+    }
+    visit(node);
+    _recorded[node] = _result;
+    return _result;
+}
+
+int GradientTape::emit(Kind kind, int a, int b, int builtin)
+{
+    Entry entry;
+    entry.kind = (uint8_t) kind;
+    entry.builtin = (uint8_t) builtin;
+    entry.a = a;
+    entry.b = b;
+    entry.value = 0;
+    _entries.push_back(entry);
+    return (int) _entries.size() - 1;
+}
+
+} /* Doppio namespace */
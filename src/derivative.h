@@ -0,0 +1,160 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_DERIVATIVE_H_
+#define DOPPIO_DERIVATIVE_H_
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+#include "ast.h"
+#include "builtins.h"
+#include "scope.h"
+
+namespace Doppio
+{
+
+// Symbolic differentiation of bound expression trees.
+//
+// The derivative with respect to one variable is a new tree that is bound
+// already, so it can be evaluated or compiled like any other. It shares
+// the subtrees of the original that it needs, and new nodes go to the
+// given zone. Derivatives known to be zero are dropped while the tree is
+// built; running the Optimizer over the result removes what is left of
+// the bookkeeping.
+//
+// Every operator and built-in is covered. '!', floor and ceil are
+// piecewise constant and have derivative zero; u % v is differentiated as
+// u - v * floor(u / v). The derivatives of abs, min and max divide by |u|
+// or |u - v| and are NaN where those are zero.
+class Differentiator: public AstVisitor<Differentiator>
+{
+public:
+    explicit Differentiator(Zone* zone);
+    ~Differentiator();
+
+    // Returns the derivative of the tree by the variable in the slot, or
+    // NULL if the tree assigns to variables or the names of the built-ins
+    // it needs do not fit in the symbol table.
+    Expression* differentiate(Expression* expression, int slot);
+
+#define DECLARE_VISIT(type) void visit##type(type* node);
+    EXPRESSION_NODE_LIST(DECLARE_VISIT)
+#undef DECLARE_VISIT
+
+private:
+    Zone* _zone;
+    int _slot;
+    bool _assigns;
+    bool _full;
+
+    // The derivative of the visited node, NULL if it is zero.
+    Expression* _result;
+    std::unordered_map<Expression*, Expression*> _derivatives;
+
+    Expression* derivative(Expression* node);
+    Expression* number(long value);
+    Expression* number(double value);
+    Expression* add(Expression* left, Expression* right);
+    Expression* subtract(Expression* left, Expression* right);
+    Expression* multiply(Expression* left, Expression* right);
+    Expression* divide(Expression* left, Expression* right);
+    Expression* binary(Token::Type operation, Expression* left,
+            Expression* right);
+    Expression* call(Builtins::Id id, Expression* argument,
+            Expression* second = NULL);
+};
+
+// Reverse-mode automatic differentiation. The tree is recorded once into a
+// flat tape; evaluate() then computes the value in a forward sweep and the
+// derivatives by every variable in one backward sweep, whatever their
+// number.
+//
+// The tape computes every operation in double precision and ignores
+// static types. The evaluators and CompiledExpression compute integers
+// in 64-bit arithmetic instead: variables declared 'int' or 'long' are
+// truncated as they are loaded and assigned, '%' of two integers is the
+// truncating remainder rather than x - n floor(x / n), and sums and
+// products wrap around. Integers also arise from integer values assigned
+// inside the expression. Where neither occurs, the tape computes the same
+// values. Values assigned inside the expression are followed to where
+// they are read, but the variables themselves are not modified. A tape
+// keeps its own scratch space; use one per thread.
+class GradientTape: public AstVisitor<GradientTape>
+{
+public:
+    GradientTape(Expression* expression, const Scope* scope);
+    ~GradientTape();
+
+    // Stores the derivative by variables[slot] in gradient[slot] for every
+    // variable of the scope and returns the value.
+    double evaluate(const double* variables, double* gradient);
+
+    // Number of recorded operations.
+    int length() const
+    {
+        return (int) _entries.size();
+    }
+
+#define DECLARE_VISIT(type) void visit##type(type* node);
+    EXPRESSION_NODE_LIST(DECLARE_VISIT)
+#undef DECLARE_VISIT
+
+private:
+    enum Kind
+    {
+        CONSTANT, VARIABLE, ADD, SUB, MUL, DIV, MOD, POW, FACTORIAL, CALL1,
+        CALL2
+    };
+
+    // Operands a and b are indexes of earlier entries. A CONSTANT holds
+    // its value in value, a VARIABLE its slot in a.
+    struct Entry
+    {
+        uint8_t kind;
+        uint8_t builtin;
+        int32_t a;
+        int32_t b;
+        double value;
+    };
+
+    int _variableCount;
+    std::vector<Entry> _entries;
+
+    // While recording: the entry of the visited node, the entry holding
+    // the current value of each variable and the entries of the subtrees
+    // recorded since the last assignment.
+    int _result;
+    std::vector<int> _variables;
+    std::unordered_map<Expression*, int> _recorded;
+
+    std::vector<double> _values;
+    std::vector<double> _adjoints;
+
+    int record(Expression* node);
+    int emit(Kind kind, int a, int b = -1, int builtin = 0);
+
+    // Tapes are not copyable.
+    GradientTape(const GradientTape&);
+    GradientTape& operator=(const GradientTape&);
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_DERIVATIVE_H_ */
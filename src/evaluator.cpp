@@ -0,0 +1,111 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "evaluator.h"
+#include "builtins.h"
+
+namespace Doppio
+{
+
+Evaluator::Evaluator(Expression* expression) :
+        _expression(expression), _environment(NULL)
+{
+}
+
+Evaluator::~Evaluator()
+{
+}
+
+Value Evaluator::evaluate(Value* environment)
+{
+    _environment = environment;
+    visit(_expression);
+    return _result;
+}
+
+void Evaluator::visitAssignmentExpression(AssignmentExpression* node)
+{
+    visit(node->value());
+    Identifier* target = node->target()->asIdentifier();
+    _result = _result.convertTo(target->staticType());
+    _environment[target->slot()] = _result;
+}
+
+void Evaluator::visitUnaryOperationExpression(UnaryOperationExpression* node)
+{
+    ASSERT(node->operation() == Token::FACTORIAL);
+    visit(node->expression());
+    _result = Value::factorial(_result);
+}
+
+void Evaluator::visitBinaryOperationExpression(BinaryOperationExpression* node)
+{
+    visit(node->left());
+    Value left = _result;
+    visit(node->right());
+    switch (node->operation())
+    {
+    case Token::ADD:
+        _result = left + _result;
+        break;
+    case Token::SUB:
+        _result = left - _result;
+        break;
+    case Token::MUL:
+        _result = left * _result;
+        break;
+    case Token::DIV:
+        _result = left / _result;
+        break;
+    case Token::MOD:
+        _result = left % _result;
+        break;
+    case Token::POW:
+        _result = left ^ _result;
+        break;
+    default:
+        ASSERT(false);
+        break;
+    }
+}
+
+void Evaluator::visitFunctionExpression(FunctionExpression* node)
+{
+    ASSERT(node->builtin() >= 0);
+    Value arguments[Builtins::kMaxArity];
+    for (int i = 0; i < node->arguments().length(); i++)
+    {
+        visit(node->arguments()[i]);
+        arguments[i] = _result;
+    }
+    _result = Builtins::Call((Builtins::Id) node->builtin(), arguments);
+}
+
+void Evaluator::visitIdentifier(Identifier* node)
+{
+    ASSERT(node->slot() >= 0);
+    _result = _environment[node->slot()].convertTo(node->staticType());
+}
+
+void Evaluator::visitNumber(Number* node)
+{
+    _result = node->value();
+}
+
+} /* Doppio namespace */
@@ -0,0 +1,55 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_EVALUATOR_H_
+#define DOPPIO_EVALUATOR_H_
+
+#include "ast.h"
+
+namespace Doppio
+{
+
+// Tree-walking evaluator. The tree must have been bound by a Binder; then
+// variables are read from and assigned to environment[slot] and no name
+// is looked up during evaluation, so one tree can be evaluated any number
+// of times against different environments.
+class Evaluator: public AstVisitor<Evaluator>
+{
+public:
+    explicit Evaluator(Expression* expression);
+    ~Evaluator();
+
+    // The environment holds one value per slot of the Scope the tree was
+    // bound in. Typed variables are read and assigned as values of their
+    // type.
+    Value evaluate(Value* environment);
+
+#define DECLARE_VISIT(type) void visit##type(type* node);
+    EXPRESSION_NODE_LIST(DECLARE_VISIT)
+#undef DECLARE_VISIT
+
+private:
+    Expression* _expression;
+    Value* _environment;
+    Value _result;
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_EVALUATOR_H_ */
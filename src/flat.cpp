@@ -0,0 +1,332 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <cstring>
+#include <unordered_map>
+#include "flat.h"
+#include "builtins.h"
+
+namespace Doppio
+{
+
+static_assert(sizeof(FlatNode) == 12, "flat nodes must stay 12 bytes");
+static_assert(Token::NUM_TOKENS <= 256, "operations must fit in a byte");
+
+// Appends the nodes of a tree to a FlatTree in postorder. Nodes already
+// appended are looked up by address, so shared nodes are appended once.
+class FlatTreeBuilder: public AstVisitor<FlatTreeBuilder>
+{
+public:
+    explicit FlatTreeBuilder(FlatTree* tree) :
+            _tree(tree), _index(0)
+    {
+    }
+
+    uint32_t add(Expression* node)
+    {
+        std::unordered_map<Expression*, uint32_t>::const_iterator it =
+                _indices.find(node);
+        if (it != _indices.end())
+        {
+            return it->second;
+        }
+        visit(node);
+        _indices[node] = _index;
+        return _index;
+    }
+
+    void visitAssignmentExpression(AssignmentExpression* node)
+    {
+        uint32_t value = add(node->value());
+        uint32_t target = add(node->target());
+        append(node, FlatNode::ASSIGNMENT, node->operation(), target, value);
+    }
+
+    void visitUnaryOperationExpression(UnaryOperationExpression* node)
+    {
+        uint32_t expression = add(node->expression());
+        append(node, FlatNode::UNARY, node->operation(), expression, 0);
+    }
+
+    void visitBinaryOperationExpression(
+            BinaryOperationExpression* node)
+    {
+        uint32_t left = add(node->left());
+        uint32_t right = add(node->right());
+        append(node, FlatNode::BINARY, node->operation(), left, right);
+    }
+
+    void visitFunctionExpression(FunctionExpression* node)
+    {
+        // arguments may contain calls themselves, so the indices are
+        // collected before they are appended to the side table
+        std::vector<uint32_t> arguments;
+        for (int i = 0; i < node->arguments().length(); i++)
+        {
+            arguments.push_back(add(node->arguments()[i]));
+        }
+        Identifier* callee = node->identifier()->asIdentifier();
+        ASSERT(callee != NULL);
+
+        FlatCall call;
+        call.callee = callee->symbol();
+        call.builtin = node->builtin();
+        call.firstArgument = (uint32_t) _tree->_arguments.size();
+        call.argumentCount = (uint32_t) arguments.size();
+        _tree->_arguments.insert(_tree->_arguments.end(), arguments.begin(),
+                arguments.end());
+        _tree->_calls.push_back(call);
+        append(node, FlatNode::CALL, 0, (uint32_t) _tree->_calls.size() - 1,
+                0);
+    }
+
+    void visitIdentifier(Identifier* node)
+    {
+        uint32_t slot = node->slot() < 0 ? FlatNode::kUnbound : node->slot();
+        append(node, FlatNode::IDENTIFIER, node->declaredType(),
+                node->symbol(), slot);
+    }
+
+    void visitNumber(Number* node)
+    {
+        uint64_t bits;
+        if (node->value().isInteger())
+        {
+            long integer = node->integer();
+            memcpy(&bits, &integer, sizeof(bits));
+        }
+        else
+        {
+            double real = node->real();
+            memcpy(&bits, &real, sizeof(bits));
+        }
+        append(node, FlatNode::NUMBER, 0, (uint32_t) bits,
+                (uint32_t) (bits >> 32));
+    }
+
+private:
+    FlatTree* _tree;
+    std::unordered_map<Expression*, uint32_t> _indices;
+    uint32_t _index;
+
+    void append(Expression* node, FlatNode::Kind kind, int operation,
+            uint32_t first, uint32_t second)
+    {
+        FlatNode flat;
+        flat.kind = kind;
+        flat.operation = operation;
+        flat.type = node->staticType();
+        flat.reserved = 0;
+        flat.first = first;
+        flat.second = second;
+        _index = (uint32_t) _tree->_nodes.size();
+        _tree->_nodes.push_back(flat);
+    }
+};
+
+FlatTree::FlatTree(Expression* expression)
+{
+    FlatTreeBuilder builder(this);
+    builder.add(expression);
+    // trees are kept resident, so the slack of the vectors is given back
+    _nodes.shrink_to_fit();
+    _calls.shrink_to_fit();
+    _arguments.shrink_to_fit();
+}
+
+FlatTree::~FlatTree()
+{
+}
+
+Value FlatTree::number(int index) const
+{
+    const FlatNode& node = _nodes[index];
+    ASSERT(node.kind == FlatNode::NUMBER);
+    uint64_t bits = node.first | (uint64_t) node.second << 32;
+    if (node.type == INTEGER_TYPE)
+    {
+        long integer;
+        memcpy(&integer, &bits, sizeof(integer));
+        return Value(integer);
+    }
+    double real;
+    memcpy(&real, &bits, sizeof(real));
+    return Value(real);
+}
+
+size_t FlatTree::memoryUsage() const
+{
+    return _nodes.capacity() * sizeof(FlatNode)
+            + _calls.capacity() * sizeof(FlatCall)
+            + _arguments.capacity() * sizeof(uint32_t);
+}
+
+Expression* FlatTree::toExpression(Zone* zone) const
+{
+    // children come first, so every operand has been built already
+    std::vector<Expression*> built(_nodes.size());
+    for (size_t i = 0; i < _nodes.size(); i++)
+    {
+        const FlatNode& node = _nodes[i];
+        Token::Type operation = (Token::Type) node.operation;
+        Expression* result;
+        switch (node.kind)
+        {
+        case FlatNode::ASSIGNMENT:
+            result = new (zone) AssignmentExpression(operation,
+                    built[node.first], built[node.second]);
+            break;
+        case FlatNode::UNARY:
+            result = new (zone) UnaryOperationExpression(operation,
+                    built[node.first]);
+            break;
+        case FlatNode::BINARY:
+            result = new (zone) BinaryOperationExpression(operation,
+                    built[node.first], built[node.second]);
+            break;
+        case FlatNode::CALL:
+        {
+            const FlatCall& call = _calls[node.first];
+            ZoneList<Expression*> arguments;
+            for (uint32_t j = 0; j < call.argumentCount; j++)
+            {
+                arguments.add(built[_arguments[call.firstArgument + j]],
+                        zone);
+            }
+            FunctionExpression* function = new (zone) FunctionExpression(
+                    new (zone) Identifier(call.callee), arguments);
+            function->bind(call.builtin);
+            result = function;
+            break;
+        }
+        case FlatNode::IDENTIFIER:
+        {
+            Identifier* identifier = new (zone) Identifier(node.first,
+                    (StaticType) node.operation);
+            if (node.second != FlatNode::kUnbound)
+            {
+                identifier->bind(node.second);
+            }
+            result = identifier;
+            break;
+        }
+        case FlatNode::NUMBER:
+            result = new (zone) Number(number(i));
+            break;
+        default:
+            ASSERT(false);
+            result = NULL;
+            break;
+        }
+        result->setStaticType((StaticType) node.type);
+        built[i] = result;
+    }
+    return built.back();
+}
+
+FlatEvaluator::FlatEvaluator(const FlatTree* tree) :
+        _tree(tree), _values(tree->length())
+{
+}
+
+FlatEvaluator::~FlatEvaluator()
+{
+}
+
+Value FlatEvaluator::evaluate(Value* environment)
+{
+    Value* values = _values.data();
+    int length = _tree->length();
+    for (int i = 0; i < length; i++)
+    {
+        const FlatNode& node = _tree->node(i);
+        switch (node.kind)
+        {
+        case FlatNode::ASSIGNMENT:
+        {
+            const FlatNode& target = _tree->node(node.first);
+            values[i] = values[node.second].convertTo(
+                    (StaticType) target.type);
+            environment[target.second] = values[i];
+            break;
+        }
+        case FlatNode::UNARY:
+            ASSERT(node.operation == Token::FACTORIAL);
+            values[i] = Value::factorial(values[node.first]);
+            break;
+        case FlatNode::BINARY:
+        {
+            const Value& left = values[node.first];
+            const Value& right = values[node.second];
+            switch (node.operation)
+            {
+            case Token::ADD:
+                values[i] = left + right;
+                break;
+            case Token::SUB:
+                values[i] = left - right;
+                break;
+            case Token::MUL:
+                values[i] = left * right;
+                break;
+            case Token::DIV:
+                values[i] = left / right;
+                break;
+            case Token::MOD:
+                values[i] = left % right;
+                break;
+            case Token::POW:
+                values[i] = left ^ right;
+                break;
+            default:
+                ASSERT(false);
+                break;
+            }
+            break;
+        }
+        case FlatNode::CALL:
+        {
+            const FlatCall& call = _tree->call(node.first);
+            ASSERT(call.builtin >= 0);
+            Value arguments[Builtins::kMaxArity];
+            for (uint32_t j = 0; j < call.argumentCount; j++)
+            {
+                arguments[j] = values[_tree->argument(call.firstArgument + j)];
+            }
+            values[i] = Builtins::Call((Builtins::Id) call.builtin, arguments);
+            break;
+        }
+        case FlatNode::IDENTIFIER:
+            // also read for assignment targets, whose value is not used
+            ASSERT(node.second != FlatNode::kUnbound);
+            values[i] = environment[node.second].convertTo(
+                    (StaticType) node.type);
+            break;
+        case FlatNode::NUMBER:
+            values[i] = _tree->number(i);
+            break;
+        default:
+            ASSERT(false);
+            break;
+        }
+    }
+    return values[length - 1];
+}
+
+} /* Doppio namespace */
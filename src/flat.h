@@ -0,0 +1,148 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_FLAT_H_
+#define DOPPIO_FLAT_H_
+
+#include <stdint.h>
+#include <vector>
+#include "ast.h"
+
+namespace Doppio
+{
+
+// One node of a FlatTree, 12 bytes. What the operands hold depends on the
+// kind:
+//   ASSIGNMENT  operation is ASSIGN, INIT_VAR or INIT_CONST; first is the
+//               target identifier, second the value
+//   UNARY       operation, first is the operand
+//   BINARY      operation, first and second are the operands
+//   CALL        first indexes FlatTree::call()
+//   IDENTIFIER  operation is the declared StaticType; first is the Symbol,
+//               second the slot or kUnbound
+//   NUMBER      first and second hold the bits of the long or double
+//               value, which is told by type
+struct FlatNode
+{
+    enum Kind
+    {
+        ASSIGNMENT, UNARY, BINARY, CALL, IDENTIFIER, NUMBER
+    };
+
+    static const uint32_t kUnbound = 0xffffffff;
+
+    uint8_t kind;
+    uint8_t operation;
+    uint8_t type;
+    uint8_t reserved;
+    uint32_t first;
+    uint32_t second;
+};
+
+// A call in the side table of a FlatTree. The argument nodes are
+// arguments[firstArgument, firstArgument + argumentCount).
+struct FlatCall
+{
+    Symbol callee;
+    int builtin;
+    uint32_t firstArgument;
+    uint32_t argumentCount;
+};
+
+// Compact form of an expression tree for keeping many parsed formulas
+// resident. Nodes are stored in one array in postorder, children before
+// their parents and operands in evaluation order, and refer to each other
+// by index; the root is the last node. Passes over the tree are loops over
+// the array rather than recursive walks.
+//
+// Converting a DAG, such as one built by SubexpressionSharing, keeps
+// shared nodes shared. Slots, built-ins and static types are carried over
+// in both directions, so a tree may be flattened before or after binding.
+class FlatTree
+{
+public:
+    explicit FlatTree(Expression* expression);
+    ~FlatTree();
+
+    int length() const
+    {
+        return (int) _nodes.size();
+    }
+
+    const FlatNode& node(int index) const
+    {
+        return _nodes[index];
+    }
+
+    int root() const
+    {
+        return length() - 1;
+    }
+
+    const FlatCall& call(int index) const
+    {
+        return _calls[index];
+    }
+
+    uint32_t argument(int index) const
+    {
+        return _arguments[index];
+    }
+
+    // The value of a NUMBER node.
+    Value number(int index) const;
+
+    // Bytes held by the node array and the side tables.
+    size_t memoryUsage() const;
+
+    // Rebuilds the tree as AST nodes allocated in zone.
+    Expression* toExpression(Zone* zone) const;
+
+private:
+    std::vector<FlatNode> _nodes;
+    std::vector<FlatCall> _calls;
+    std::vector<uint32_t> _arguments;
+
+    friend class FlatTreeBuilder;
+};
+
+// Evaluates a bound FlatTree in one pass over its nodes, with the same
+// results and effects on the environment as the Evaluator. Nodes that are
+// shared are evaluated once. The tree holds no evaluation state; the
+// value of every node is kept here.
+class FlatEvaluator
+{
+public:
+    explicit FlatEvaluator(const FlatTree* tree);
+    ~FlatEvaluator();
+
+    Value evaluate(Value* environment);
+
+private:
+    const FlatTree* _tree;
+    std::vector<Value> _values;
+
+    // Flat evaluators are not copyable.
+    FlatEvaluator(const FlatEvaluator&);
+    FlatEvaluator& operator=(const FlatEvaluator&);
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_FLAT_H_ */
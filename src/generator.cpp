@@ -0,0 +1,164 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <cstdio>
+#include "generator.h"
+#include "builtins.h"
+
+namespace Doppio
+{
+
+namespace
+{
+
+// Binary operators, additive and multiplicative ones about as often as in
+// real formulas.
+const char* const kOperators[] =
+{
+    " + ", " - ", " * ", " + ", " - ", " * ", " / ", " % ", " ^ "
+};
+const int kOperatorCount = sizeof(kOperators) / sizeof(kOperators[0]);
+
+} /* anonymous namespace */
+
+FormulaGenerator::FormulaGenerator(const Options& options) :
+        _options(options), _state(options.seed ? options.seed : 1)
+{
+    ASSERT(options.width >= 1);
+    ASSERT(options.identifierCount >= 1);
+}
+
+void FormulaGenerator::generate(std::string* formula)
+{
+    if (chance(_options.assignmentRatio))
+    {
+        generateIdentifier(formula, 'y');
+        formula->append(" = ");
+    }
+    generateExpression(formula, _options.depth);
+}
+
+// A number in [0, limit), from xorshift32.
+uint32_t FormulaGenerator::random(uint32_t limit)
+{
+    _state ^= _state << 13;
+    _state ^= _state >> 17;
+    _state ^= _state << 5;
+    return (uint32_t) (((uint64_t) _state * limit) >> 32);
+}
+
+bool FormulaGenerator::chance(double probability)
+{
+    return random(1u << 24) < probability * (1u << 24);
+}
+
+void FormulaGenerator::generateExpression(std::string* formula, int depth)
+{
+    int operands = 1 + random(_options.width);
+    for (int i = 0; i < operands; i++)
+    {
+        if (i > 0)
+        {
+            formula->append(kOperators[random(kOperatorCount)]);
+        }
+        generateOperand(formula, depth);
+    }
+}
+
+void FormulaGenerator::generateOperand(std::string* formula, int depth)
+{
+    if (depth > 0)
+    {
+        switch (random(4))
+        {
+        case 0:
+            formula->push_back('(');
+            generateExpression(formula, depth - 1);
+            formula->push_back(')');
+            return;
+        case 1:
+        {
+            Builtins::Id id = (Builtins::Id) random(Builtins::NUM_BUILTINS);
+            formula->append(Builtins::Name(id));
+            formula->push_back('(');
+            for (int i = 0; i < Builtins::Arity(id); i++)
+            {
+                if (i > 0)
+                {
+                    formula->append(", ");
+                }
+                generateExpression(formula, depth - 1);
+            }
+            formula->push_back(')');
+            return;
+        }
+        default:
+            break;
+        }
+    }
+    if (chance(_options.literalRatio))
+    {
+        generateLiteral(formula);
+    }
+    else
+    {
+        generateIdentifier(formula, 'x');
+        // factorial only of variables, literals would be folded and
+        // large ones overflow
+        if (random(16) == 0)
+        {
+            formula->push_back('!');
+        }
+    }
+}
+
+void FormulaGenerator::generateLiteral(std::string* formula)
+{
+    char buffer[32];
+    switch (random(6))
+    {
+    case 0:
+    case 1:
+    case 2:
+        snprintf(buffer, sizeof(buffer), "%u", random(1000));
+        break;
+    case 3:
+        snprintf(buffer, sizeof(buffer), "%u.%u", random(100), random(1000));
+        break;
+    case 4:
+        snprintf(buffer, sizeof(buffer), "%u.", random(100));
+        break;
+    default:
+        snprintf(buffer, sizeof(buffer), "%u.%ue%s%u", random(10),
+                random(100), random(2) ? "-" : "+", random(20));
+        break;
+    }
+    formula->append(buffer);
+}
+
+void FormulaGenerator::generateIdentifier(std::string* formula,
+        char prefix)
+{
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%c%u", prefix,
+            random(_options.identifierCount));
+    formula->append(buffer);
+}
+
+} /* Doppio namespace */
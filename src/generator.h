@@ -0,0 +1,85 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_GENERATOR_H_
+#define DOPPIO_GENERATOR_H_
+
+#include <stdint.h>
+#include <string>
+
+namespace Doppio
+{
+
+// Generates random formulas from the grammar in doppio.g, for benchmarks.
+// All productions are used: variables, integer and real literals in every
+// notation the scanner reads, the binary operators, parentheses, calls of
+// built-ins with the right number of arguments, '!' and '='. The formulas
+// always parse and bind. The same options give the same formulas.
+class FormulaGenerator
+{
+public:
+    struct Options
+    {
+        // Levels of parentheses and calls nested in each other.
+        int depth;
+
+        // Largest number of operands in a chain of binary operators.
+        int width;
+
+        // Share of operands that are literals rather than variables.
+        double literalRatio;
+
+        // Number of distinct variables, x0 up to x<identifierCount - 1>.
+        int identifierCount;
+
+        // Share of formulas that assign to a variable. Targets are named
+        // y0 up to y<identifierCount - 1> and are never read, so the
+        // values of a corpus do not depend on the order of evaluation.
+        double assignmentRatio;
+
+        uint32_t seed;
+
+        Options() :
+                depth(3), width(4), literalRatio(0.3), identifierCount(16),
+                assignmentRatio(0.0), seed(1)
+        {
+        }
+    };
+
+    explicit FormulaGenerator(const Options& options);
+
+    // Appends one formula, without a terminating ';'.
+    void generate(std::string* formula);
+
+private:
+    Options _options;
+    uint32_t _state;
+
+    uint32_t random(uint32_t limit);
+    bool chance(double probability);
+
+    void generateExpression(std::string* formula, int depth);
+    void generateOperand(std::string* formula, int depth);
+    void generateLiteral(std::string* formula);
+    void generateIdentifier(std::string* formula, char prefix);
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_GENERATOR_H_ */
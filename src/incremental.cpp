@@ -0,0 +1,176 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "incremental.h"
+
+namespace Doppio
+{
+
+namespace
+{
+
+// A full parse replaces the zone once it holds this many times the bytes
+// of a freshly parsed tree, plus some slack for small formulas.
+const size_t kGarbageFactor = 3;
+const size_t kGarbageSlack = 64 * 1024;
+
+} /* anonymous namespace */
+
+OperandTable::OperandTable() :
+        _foundCount(0)
+{
+}
+
+OperandTable::~OperandTable()
+{
+}
+
+void OperandTable::clear(int length)
+{
+    _heads.assign(length, -1);
+    _entries.clear();
+    _foundCount = 0;
+}
+
+void OperandTable::update(const TokenEdit& edit)
+{
+    // operands before the edit that reach into it are gone, and binary
+    // expressions that end at it: the token after them was scanned again
+    // and may be an operator that binds tighter now
+    for (int i = 0; i < edit.first; i++)
+    {
+        int& head = _heads[i];
+        while (head >= 0)
+        {
+            const Entry& entry = _entries[head];
+            int end = i + entry.length;
+            if (end < edit.first || (end == edit.first
+                    && entry.precedence == kPrimaryPrecedence))
+            {
+                break;
+            }
+            head = entry.next;
+        }
+    }
+
+    _heads.erase(_heads.begin() + edit.first,
+            _heads.begin() + edit.oldEnd);
+    _heads.insert(_heads.begin() + edit.first, edit.newEnd - edit.first,
+            -1);
+    _foundCount = 0;
+}
+
+Expression* OperandTable::find(int index, int precedence, int* end)
+{
+    for (int i = _heads[index]; i >= 0; i = _entries[i].next)
+    {
+        const Entry& entry = _entries[i];
+        if (entry.precedence > precedence)
+        {
+            *end = index + entry.length;
+            _foundCount++;
+            return entry.operand;
+        }
+    }
+    return NULL;
+}
+
+void OperandTable::record(int start, int end, Expression* operand,
+        int precedence)
+{
+    if (operand == NULL || operand->isConstant())
+    {
+        return;
+    }
+    // a parse that did not take the recorded operands replaces them
+    int& head = _heads[start];
+    while (head >= 0 && start + _entries[head].length >= end)
+    {
+        head = _entries[head].next;
+    }
+    Entry entry;
+    entry.operand = operand;
+    entry.length = end - start;
+    entry.precedence = precedence;
+    entry.next = head;
+    head = (int) _entries.size();
+    _entries.push_back(entry);
+}
+
+IncrementalParser::IncrementalParser() :
+        _parser(NULL), _liveSize(0), _scannedTokens(0), _reusedOperands(0)
+{
+}
+
+IncrementalParser::~IncrementalParser()
+{
+    delete _parser;
+}
+
+ParseResult IncrementalParser::parse(const char* input, size_t length)
+{
+    _text.assign(input, length);
+    return parseText();
+}
+
+ParseResult IncrementalParser::edit(size_t offset, size_t removed,
+        const char* inserted, size_t insertedLength)
+{
+    ASSERT(offset + removed <= _text.size());
+    _text.replace(offset, removed, inserted, insertedLength);
+    if (_tokens.length() == 0
+            || _zone.allocationSize() > kGarbageFactor * _liveSize
+                    + kGarbageSlack)
+    {
+        return parseText();
+    }
+
+    TokenEdit tokenEdit = _tokens.retokenize(_text.data(), _text.size(),
+            offset, removed, insertedLength);
+    // the first token behind the edit was scanned as well
+    _scannedTokens = tokenEdit.newEnd - tokenEdit.first + 1;
+    _operands.update(tokenEdit);
+    return parseTokens();
+}
+
+ParseResult IncrementalParser::parseText()
+{
+    // nothing refers to the old nodes once the parser is gone
+    delete _parser;
+    _parser = NULL;
+    _zone.deleteAll();
+    _tokens.tokenize(_text.data(), _text.size());
+    _scannedTokens = _tokens.length();
+    _operands.clear(_tokens.length());
+    ParseResult result = parseTokens();
+    _liveSize = _zone.allocationSize();
+    return result;
+}
+
+ParseResult IncrementalParser::parseTokens()
+{
+    delete _parser;
+    _parser = new Parser(&_tokens, &_zone);
+    _parser->setOperandTable(&_operands);
+    ParseResult result = _parser->parse();
+    _reusedOperands = _operands.foundCount();
+    return result;
+}
+
+} /* Doppio namespace */
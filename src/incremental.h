@@ -0,0 +1,165 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_INCREMENTAL_H_
+#define DOPPIO_INCREMENTAL_H_
+
+#include <climits>
+#include <string>
+#include <vector>
+#include "parser.h"
+#include "tokens.h"
+
+namespace Doppio
+{
+
+// Complete operands of a parse, by the index in the TokenBuffer of their
+// first token, with the index of the token after them: groups, calls and
+// the binary expressions the parser reduced, such as each prefix a+b,
+// a+b+c, ... of a chain. A later parse of the same tokens can take the
+// subtree instead of parsing it again. A group or call depends on its own
+// tokens only. A binary expression also depends on the operators around
+// it, so it is taken only where the operator before it binds weaker and
+// the token after it is unchanged. Operands that folded to a Number are
+// not recorded, because the parser may fold them further in place.
+class OperandTable
+{
+public:
+    // The precedence recorded for groups and calls, which are taken in
+    // any context.
+    static const int kPrimaryPrecedence = INT_MAX;
+
+    OperandTable();
+    ~OperandTable();
+
+    // Drops all operands of a table for length tokens.
+    void clear(int length);
+
+    // Follows a TokenBuffer::retokenize(): drops the operands that
+    // contain changed tokens and moves those behind the edit.
+    void update(const TokenEdit& edit);
+
+    // Returns the longest operand at token index whose outermost operator
+    // binds tighter than precedence and sets *end, or returns NULL.
+    Expression* find(int index, int precedence, int* end);
+
+    // Records operand for the tokens from start up to end; precedence is
+    // that of its outermost operator.
+    void record(int start, int end, Expression* operand, int precedence);
+
+    // Operands found since the last clear() or update().
+    int foundCount() const
+    {
+        return _foundCount;
+    }
+
+private:
+    // An operand with its length in tokens, which stays valid when the
+    // tokens before it move.
+    struct Entry
+    {
+        Expression* operand;
+        int length;
+        int precedence;
+        int next;
+    };
+
+    // The first of the operands starting at each token, linked longest
+    // first through Entry::next, or -1. Entries that are dropped stay in
+    // _entries until the next clear().
+    std::vector<int> _heads;
+    std::vector<Entry> _entries;
+    int _foundCount;
+
+    // Operand tables are not copyable.
+    OperandTable(const OperandTable&);
+    OperandTable& operator=(const OperandTable&);
+};
+
+// Parses a formula again after each edit of its text, for editors that
+// parse on every keystroke. An edit rescans only the tokens around it,
+// see TokenBuffer::retokenize(), and the parser takes every group and
+// call that lies wholly before or behind the edit from the previous tree,
+// as well as the longest part of each chain such as a+b+...+z that ends
+// before the edit. Only the beginnings of a chain are subtrees, so the
+// operands of a chain behind the edit are parsed again: typing at the end
+// of a formula parses a few tokens whatever its length, while an edit at
+// the start of a long flat chain costs about as much as a full parse. The
+// token array and the start of each operand in the OperandTable are moved
+// as a whole, which is one pass of copying without scanning or allocating
+// nodes.
+//
+// Trees share the reused subtrees, so a tree is valid until the next
+// edit only, as are nodes bound or annotated by other passes in the
+// meantime; passes such as the Binder set the same slots and types again
+// on reused nodes. Nodes live in a zone of the parser that is released
+// and refilled by a full parse once garbage dominates it.
+class IncrementalParser
+{
+public:
+    IncrementalParser();
+    ~IncrementalParser();
+
+    // Parses a new text from scratch.
+    ParseResult parse(const char* input, size_t length);
+
+    // Replaces removed bytes of the text at offset by inserted and parses
+    // the new text.
+    ParseResult edit(size_t offset, size_t removed, const char* inserted,
+            size_t insertedLength);
+
+    const std::string& text() const
+    {
+        return _text;
+    }
+
+    // Tokens scanned and operands reused by the last parse.
+    int scannedTokens() const
+    {
+        return _scannedTokens;
+    }
+    int reusedOperands() const
+    {
+        return _reusedOperands;
+    }
+
+private:
+    std::string _text;
+    TokenBuffer _tokens;
+    OperandTable _operands;
+    Zone _zone;
+    Parser* _parser;
+
+    // Zone bytes after the last full parse.
+    size_t _liveSize;
+
+    int _scannedTokens;
+    int _reusedOperands;
+
+    ParseResult parseText();
+    ParseResult parseTokens();
+
+    // Incremental parsers are not copyable.
+    IncrementalParser(const IncrementalParser&);
+    IncrementalParser& operator=(const IncrementalParser&);
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_INCREMENTAL_H_ */
@@ -0,0 +1,272 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <cmath>
+#include "interpreter.h"
+#include "builtins.h"
+#include "profiler.h"
+
+// GCC and Clang support labels as values, which lets each handler jump
+// straight to the next one instead of going through a shared switch.
+#if defined(__GNUC__)
+#define DOPPIO_COMPUTED_GOTO 1
+#endif
+
+namespace Doppio
+{
+
+Interpreter::Interpreter(const Bytecode* bytecode) :
+        _bytecode(bytecode)
+{
+    _registers = new Value[bytecode->registerCount()];
+    const std::vector<Value>& constants = bytecode->constants();
+    for (size_t i = 0; i < constants.size(); i++)
+    {
+        _registers[bytecode->constantBase() + i] = constants[i];
+    }
+    const std::vector<int>& reads = bytecode->readVariables();
+    for (size_t i = 0; i < reads.size(); i++)
+    {
+        if (bytecode->variableType(reads[i]) != UNKNOWN_TYPE)
+        {
+            _typedVariables.push_back(reads[i]);
+        }
+    }
+}
+
+Interpreter::~Interpreter()
+{
+    delete[] _registers;
+}
+
+Value Interpreter::evaluate(Value* environment)
+{
+    return execute<false>(environment, NULL);
+}
+
+Value Interpreter::profile(Value* environment, Profile* profile)
+{
+    ASSERT(profile->length() == (int) _bytecode->instructions().size());
+    return execute<true>(environment, profile);
+}
+
+template<bool kProfiling>
+Value Interpreter::execute(Value* environment, Profile* profile)
+{
+    // only the variables the program uses are copied, so the cost does
+    // not grow with the scope
+    const std::vector<int>& reads = _bytecode->readVariables();
+    for (size_t i = 0; i < reads.size(); i++)
+    {
+        _registers[reads[i]] = environment[reads[i]];
+    }
+    for (size_t i = 0; i < _typedVariables.size(); i++)
+    {
+        int slot = _typedVariables[i];
+        _registers[slot] = _registers[slot].convertTo(
+                _bytecode->variableType(slot));
+    }
+    Value result = run<kProfiling>(profile);
+    const std::vector<int>& assigned = _bytecode->assignedVariables();
+    for (size_t i = 0; i < assigned.size(); i++)
+    {
+        environment[assigned[i]] = _registers[assigned[i]];
+    }
+    return result;
+}
+
+// Programs are straight-line code, so an instruction that dispatches the
+// next one is the one before pc. When profiling, it is charged the cycles
+// since the previous dispatch; otherwise PROFILE() compiles to nothing.
+template<bool kProfiling>
+Value Interpreter::run(Profile* profile)
+{
+    const Instruction* code = &_bytecode->instructions()[0];
+    const Instruction* pc = code;
+    Value* r = _registers;
+    uint64_t time = kProfiling ? ReadCycleCounter() : 0;
+
+#define PROFILE(instruction)                                              \
+    if (kProfiling)                                                       \
+    {                                                                     \
+        uint64_t now = ReadCycleCounter();                                \
+        profile->record(instruction, now - time);                         \
+        time = now;                                                       \
+    }
+#ifdef DOPPIO_COMPUTED_GOTO
+#define V(name) &&L_##name,
+    static void* const labels[] = { BYTECODE_LIST(V) };
+#undef V
+#define OPCODE(name) L_##name
+#define DISPATCH() PROFILE(pc - 1 - code) goto *labels[pc->opcode]
+    goto *labels[pc->opcode];
+    {
+#else
+#define OPCODE(name) case Instruction::name
+#define DISPATCH() PROFILE(pc - 1 - code) continue
+    for (;;)
+    {
+        switch (pc->opcode)
+        {
+#endif
+
+    OPCODE(ADD):
+        r[pc->dst] = r[pc->a] + r[pc->b];
+        pc++;
+        DISPATCH();
+
+    OPCODE(SUB):
+        r[pc->dst] = r[pc->a] - r[pc->b];
+        pc++;
+        DISPATCH();
+
+    OPCODE(MUL):
+        r[pc->dst] = r[pc->a] * r[pc->b];
+        pc++;
+        DISPATCH();
+
+    OPCODE(DIV):
+        r[pc->dst] = r[pc->a] / r[pc->b];
+        pc++;
+        DISPATCH();
+
+    OPCODE(MOD):
+        r[pc->dst] = r[pc->a] % r[pc->b];
+        pc++;
+        DISPATCH();
+
+    OPCODE(POW):
+        r[pc->dst] = r[pc->a] ^ r[pc->b];
+        pc++;
+        DISPATCH();
+
+    // wrapping like Value arithmetic
+    OPCODE(ADD_INTEGER):
+        r[pc->dst] = Value((long) ((unsigned long) r[pc->a].asInteger()
+                + r[pc->b].asInteger()));
+        pc++;
+        DISPATCH();
+
+    OPCODE(SUB_INTEGER):
+        r[pc->dst] = Value((long) ((unsigned long) r[pc->a].asInteger()
+                - r[pc->b].asInteger()));
+        pc++;
+        DISPATCH();
+
+    OPCODE(MUL_INTEGER):
+        r[pc->dst] = Value((long) ((unsigned long) r[pc->a].asInteger()
+                * r[pc->b].asInteger()));
+        pc++;
+        DISPATCH();
+
+    OPCODE(MOD_INTEGER):
+    {
+        // LONG_MIN % -1 overflows
+        long n = r[pc->b].asInteger();
+        r[pc->dst] = Value(n == -1 ? 0L : r[pc->a].asInteger() % n);
+        pc++;
+        DISPATCH();
+    }
+
+    OPCODE(ADD_REAL):
+        r[pc->dst] = Value(r[pc->a].asReal() + r[pc->b].asReal());
+        pc++;
+        DISPATCH();
+
+    OPCODE(SUB_REAL):
+        r[pc->dst] = Value(r[pc->a].asReal() - r[pc->b].asReal());
+        pc++;
+        DISPATCH();
+
+    OPCODE(MUL_REAL):
+        r[pc->dst] = Value(r[pc->a].asReal() * r[pc->b].asReal());
+        pc++;
+        DISPATCH();
+
+    OPCODE(DIV_REAL):
+        r[pc->dst] = Value(r[pc->a].asReal() / r[pc->b].asReal());
+        pc++;
+        DISPATCH();
+
+    OPCODE(MOD_REAL):
+    {
+        double x = r[pc->a].asReal();
+        double n = r[pc->b].asReal();
+        r[pc->dst] = Value(x - n * floor(x / n));
+        pc++;
+        DISPATCH();
+    }
+
+    OPCODE(POW_REAL):
+        r[pc->dst] = Value(pow(r[pc->a].asReal(), r[pc->b].asReal()));
+        pc++;
+        DISPATCH();
+
+    OPCODE(FACTORIAL):
+        r[pc->dst] = Value::factorial(r[pc->a]);
+        pc++;
+        DISPATCH();
+
+    OPCODE(TO_INTEGER):
+        r[pc->dst] = Value(r[pc->a].integer());
+        pc++;
+        DISPATCH();
+
+    OPCODE(TO_REAL):
+        r[pc->dst] = Value(r[pc->a].real());
+        pc++;
+        DISPATCH();
+
+    OPCODE(ASSIGN):
+    OPCODE(MOVE):
+        r[pc->dst] = r[pc->a];
+        pc++;
+        DISPATCH();
+
+    OPCODE(CALL1):
+        r[pc->dst] = Value(Builtins::Function1Of((Builtins::Id) pc->builtin)(
+                r[pc->a].real()));
+        pc++;
+        DISPATCH();
+
+    OPCODE(CALL2):
+        r[pc->dst] = Value(Builtins::Function2Of((Builtins::Id) pc->builtin)(
+                r[pc->a].real(), r[pc->b].real()));
+        pc++;
+        DISPATCH();
+
+    OPCODE(RETURN):
+        PROFILE(pc - code)
+        return r[pc->a];
+
+#ifndef DOPPIO_COMPUTED_GOTO
+        default:
+            ASSERT(false);
+            break;
+        }
+#endif
+    }
+#undef PROFILE
+#undef OPCODE
+#undef DISPATCH
+
+    return Value(); // make compiler happy
+}
+
+} /* Doppio namespace */
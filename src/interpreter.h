@@ -0,0 +1,67 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_INTERPRETER_H_
+#define DOPPIO_INTERPRETER_H_
+
+#include "bytecode.h"
+
+namespace Doppio
+{
+
+class Profile;
+
+// Executes Bytecode. An interpreter owns the register file for one
+// program, with the constants loaded once, and evaluates it against any
+// number of environments. Interpreters are cheap; use one per thread.
+class Interpreter
+{
+public:
+    explicit Interpreter(const Bytecode* bytecode);
+    ~Interpreter();
+
+    // The environment holds one value per variable of the program. It is
+    // updated in place if the program assigns to variables. Values of
+    // typed variables are converted to their type first. Only the
+    // variables the program reads or assigns are touched.
+    Value evaluate(Value* environment);
+
+    // Evaluates like evaluate(), adding the executions and cycles of each
+    // instruction to profile, which must be for this interpreter's
+    // bytecode. The counting is compiled into this path only.
+    Value profile(Value* environment, Profile* profile);
+
+private:
+    const Bytecode* _bytecode;
+    Value* _registers;
+    std::vector<int> _typedVariables;
+
+    template<bool kProfiling>
+    Value execute(Value* environment, Profile* profile);
+    template<bool kProfiling>
+    Value run(Profile* profile);
+
+    // Interpreters are not copyable.
+    Interpreter(const Interpreter&);
+    Interpreter& operator=(const Interpreter&);
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_INTERPRETER_H_ */
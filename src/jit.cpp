@@ -0,0 +1,564 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <cmath>
+#include <cstring>
+#include "jit.h"
+#include "builtins.h"
+#include "compiler.h"
+#include "stats.h"
+#include "typing.h"
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define DOPPIO_JIT 1
+#include <sys/mman.h>
+#endif
+
+namespace Doppio
+{
+
+#ifdef DOPPIO_JIT
+
+namespace
+{
+
+// Helpers for the operations that have no single SSE2 instruction. They
+// follow Value, computing in double precision.
+double jitMod(double x, double n)
+{
+    return x - n * floor(x / n);
+}
+
+double jitPow(double x, double y)
+{
+    return pow(x, y);
+}
+
+long jitFactorial(long n)
+{
+    return Value::factorial(Value(n)).integer();
+}
+
+// General purpose registers by their encoding.
+enum Register
+{
+    RAX = 0, RCX = 1, RDX = 2, RDI = 7
+};
+
+// Emits code for the expression with xmm0..xmm15 used as an evaluation
+// stack: the value of a node visited at depth d ends up in xmm<d>. rbx
+// holds the variables pointer and the frame has one spill slot per xmm
+// register, used to save live registers around calls.
+//
+// Nodes that TypeInference types as integers hold a 64-bit integer in the
+// low lane of their register and are computed with integer instructions;
+// they are converted to reals only where a real operation uses them. All
+// other nodes are reals, as the variables passed to native code are.
+class JitCompiler: public AstVisitor<JitCompiler>
+{
+public:
+    JitCompiler() :
+            _depth(0), _failed(false)
+    {
+    }
+
+    bool compile(Expression* expression)
+    {
+        // push rbx; mov rbx, rdi; sub rsp, kFrameSize
+        emit(0x53);
+        emit(0x48, 0x89, 0xFB);
+        emit(0x48, 0x81, 0xEC);
+        emit32(kFrameSize);
+
+        visit(expression);
+        convertToReal(expression, 0);
+
+        // add rsp, kFrameSize; pop rbx; ret
+        emit(0x48, 0x81, 0xC4);
+        emit32(kFrameSize);
+        emit(0x5B);
+        emit(0xC3);
+        return !_failed;
+    }
+
+    const std::vector<unsigned char>& code() const
+    {
+        return _code;
+    }
+
+    void visitAssignmentExpression(AssignmentExpression*)
+    {
+        // variables are read-only to native code
+        _failed = true;
+    }
+
+    void visitUnaryOperationExpression(UnaryOperationExpression* node)
+    {
+        ASSERT(node->operation() == Token::FACTORIAL);
+        visit(node->expression());
+        if (isInteger(node->expression()))
+        {
+            moveFromXmm(RDI, _depth);
+        }
+        else
+        {
+            // cvttsd2si rdi, xmm<d> truncates like Value::integer()
+            emit(0xF2);
+            rex(true, RDI, _depth);
+            emit(0x0F, 0x2C);
+            emit(0xC0 | RDI << 3 | (_depth & 7));
+        }
+        callInteger((void*) jitFactorial);
+    }
+
+    void visitBinaryOperationExpression(
+            BinaryOperationExpression* node)
+    {
+        if (!push())
+        {
+            return;
+        }
+        visit(node->left());
+        _depth++;
+        visit(node->right());
+        _depth--;
+
+        if (isInteger(node))
+        {
+            integerOperation(node);
+            return;
+        }
+        if (node->operation() == Token::MOD && isInteger(node->left())
+                && isInteger(node->right()))
+        {
+            // an integer remainder that may be NaN is left to the
+            // interpreter
+            _failed = true;
+            return;
+        }
+        convertToReal(node->left(), _depth);
+        convertToReal(node->right(), _depth + 1);
+
+        switch (node->operation())
+        {
+        case Token::ADD:
+            sse(0x58, _depth, _depth + 1);
+            break;
+        case Token::SUB:
+            sse(0x5C, _depth, _depth + 1);
+            break;
+        case Token::MUL:
+            sse(0x59, _depth, _depth + 1);
+            break;
+        case Token::DIV:
+            sse(0x5E, _depth, _depth + 1);
+            break;
+        case Token::MOD:
+            call((void*) jitMod, 2);
+            break;
+        case Token::POW:
+            call((void*) jitPow, 2);
+            break;
+        default:
+            _failed = true;
+            break;
+        }
+    }
+
+    void visitFunctionExpression(FunctionExpression* node)
+    {
+        ASSERT(node->builtin() >= 0);
+        Builtins::Id id = (Builtins::Id) node->builtin();
+        const ZoneList<Expression*>& arguments = node->arguments();
+        if (!push())
+        {
+            return;
+        }
+        for (int i = 0; i < arguments.length(); i++)
+        {
+            _depth += i;
+            visit(arguments[i]);
+            convertToReal(arguments[i], _depth);
+            _depth -= i;
+        }
+        if (arguments.length() == 1)
+        {
+            call((void*) Builtins::Function1Of(id), 1);
+        }
+        else
+        {
+            call((void*) Builtins::Function2Of(id), 2);
+        }
+    }
+
+    void visitIdentifier(Identifier* node)
+    {
+        ASSERT(node->slot() >= 0);
+        if (isInteger(node))
+        {
+            // cvttsd2si rax, [rbx + 8 * slot]; movq xmm<d>, rax
+            emit(0xF2, 0x48, 0x0F);
+            emit(0x2C, 0x80 | RAX << 3 | 3);
+            emit32(8 * node->slot());
+            moveToXmm(_depth, RAX);
+            return;
+        }
+        // movsd xmm<d>, [rbx + 8 * slot]
+        emit(0xF2);
+        rex(false, _depth, 0);
+        emit(0x0F, 0x10);
+        emit(0x80 | (_depth & 7) << 3 | 3);
+        emit32(8 * node->slot());
+    }
+
+    void visitNumber(Number* node)
+    {
+        uint64_t bits;
+        if (isInteger(node))
+        {
+            long value = node->integer();
+            memcpy(&bits, &value, sizeof(bits));
+        }
+        else
+        {
+            double value = node->real();
+            memcpy(&bits, &value, sizeof(bits));
+        }
+        // mov rax, imm64; movq xmm<d>, rax
+        emit(0x48, 0xB8);
+        for (int i = 0; i < 8; i++)
+        {
+            emit((bits >> (8 * i)) & 0xFF);
+        }
+        moveToXmm(_depth, RAX);
+    }
+
+private:
+    static const int kRegisters = 16;
+    static const int kFrameSize = 8 * kRegisters;
+
+    std::vector<unsigned char> _code;
+    int _depth;
+    bool _failed;
+
+    // Checks that a node at the current depth has a register for its
+    // second operand.
+    bool push()
+    {
+        if (_depth + 1 >= kRegisters)
+        {
+            _failed = true;
+        }
+        return !_failed;
+    }
+
+    void emit(int byte)
+    {
+        _code.push_back((unsigned char) byte);
+    }
+
+    void emit(int byte1, int byte2)
+    {
+        emit(byte1);
+        emit(byte2);
+    }
+
+    void emit(int byte1, int byte2, int byte3)
+    {
+        emit(byte1);
+        emit(byte2);
+        emit(byte3);
+    }
+
+    void emit32(int value)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            emit((value >> (8 * i)) & 0xFF);
+        }
+    }
+
+    // Emits a REX prefix if one is needed to reach registers 8..15 or for
+    // a 64-bit operand.
+    void rex(bool wide, int reg, int rm)
+    {
+        int prefix = 0x40 | (wide ? 8 : 0) | (reg >= 8 ? 4 : 0)
+                | (rm >= 8 ? 1 : 0);
+        if (prefix != 0x40)
+        {
+            emit(prefix);
+        }
+    }
+
+    // Scalar double instruction xmm<dst> = xmm<dst> op xmm<src>.
+    void sse(int opcode, int dst, int src)
+    {
+        emit(0xF2);
+        rex(false, dst, src);
+        emit(0x0F, opcode);
+        emit(0xC0 | (dst & 7) << 3 | (src & 7));
+    }
+
+    static bool isInteger(Expression* node)
+    {
+        return node->staticType() == INTEGER_TYPE;
+    }
+
+    // '+', '-', '*' and '%' of two integers. The divisor of '%' is a
+    // non-zero constant.
+    void integerOperation(BinaryOperationExpression* node)
+    {
+        switch (node->operation())
+        {
+        case Token::ADD:
+            // paddq xmm<d>, xmm<d+1>
+            packed(0xD4, _depth, _depth + 1);
+            break;
+        case Token::SUB:
+            // psubq xmm<d>, xmm<d+1>
+            packed(0xFB, _depth, _depth + 1);
+            break;
+        case Token::MUL:
+            // imul rax, rcx
+            moveFromXmm(RAX, _depth);
+            moveFromXmm(RCX, _depth + 1);
+            emit(0x48, 0x0F, 0xAF);
+            emit(0xC0 | RAX << 3 | RCX);
+            moveToXmm(_depth, RAX);
+            break;
+        case Token::MOD:
+            if (node->right()->asNumber()->integer() == -1)
+            {
+                // LONG_MIN % -1 traps; pxor xmm<d>, xmm<d>
+                packed(0xEF, _depth, _depth);
+                break;
+            }
+            // cqo; idiv rcx, leaving the remainder in rdx
+            moveFromXmm(RAX, _depth);
+            moveFromXmm(RCX, _depth + 1);
+            emit(0x48, 0x99);
+            emit(0x48, 0xF7, 0xF8 | RCX);
+            moveToXmm(_depth, RDX);
+            break;
+        default:
+            _failed = true;
+            break;
+        }
+    }
+
+    // Converts the value of node in xmm<reg> to a real if it is an
+    // integer.
+    void convertToReal(Expression* node, int reg)
+    {
+        if (isInteger(node))
+        {
+            // cvtsi2sd xmm<reg>, rax
+            moveFromXmm(RAX, reg);
+            emit(0xF2);
+            rex(true, reg, RAX);
+            emit(0x0F, 0x2A);
+            emit(0xC0 | (reg & 7) << 3 | RAX);
+        }
+    }
+
+    // Packed integer instruction xmm<dst> = xmm<dst> op xmm<src>.
+    void packed(int opcode, int dst, int src)
+    {
+        emit(0x66);
+        rex(false, dst, src);
+        emit(0x0F, opcode);
+        emit(0xC0 | (dst & 7) << 3 | (src & 7));
+    }
+
+    // movq xmm<reg>, gpr and movq gpr, xmm<reg>.
+    void moveToXmm(int reg, Register gpr)
+    {
+        emit(0x66);
+        rex(true, reg, 0);
+        emit(0x0F, 0x6E);
+        emit(0xC0 | (reg & 7) << 3 | gpr);
+    }
+
+    void moveFromXmm(Register gpr, int reg)
+    {
+        emit(0x66);
+        rex(true, reg, 0);
+        emit(0x0F, 0x7E);
+        emit(0xC0 | (reg & 7) << 3 | gpr);
+    }
+
+    void moveRegister(int dst, int src)
+    {
+        if (dst != src)
+        {
+            sse(0x10, dst, src);
+        }
+    }
+
+    // movsd [rsp + 8 * slot], xmm<reg> or the reverse.
+    void spill(int reg, bool store)
+    {
+        emit(0xF2);
+        rex(false, reg, 0);
+        emit(0x0F, store ? 0x11 : 0x10);
+        emit(0x44 | (reg & 7) << 3, 0x24, 8 * reg);
+    }
+
+    // Calls a C function whose arguments are in xmm<d>, xmm<d+1>, leaving
+    // its result in xmm<d>. All xmm registers are caller-saved, so the
+    // live ones below d are spilled around the call.
+    void call(void* function, int arity)
+    {
+        if (_failed)
+        {
+            return;
+        }
+        for (int reg = 0; reg < _depth; reg++)
+        {
+            spill(reg, true);
+        }
+        for (int i = 0; i < arity; i++)
+        {
+            moveRegister(i, _depth + i);
+        }
+        callAddress(function);
+        moveRegister(_depth, 0);
+        for (int reg = 0; reg < _depth; reg++)
+        {
+            spill(reg, false);
+        }
+    }
+
+    // Calls a C function of one integer, passed in rdi, and leaves its
+    // integer result in xmm<d>.
+    void callInteger(void* function)
+    {
+        if (_failed)
+        {
+            return;
+        }
+        for (int reg = 0; reg < _depth; reg++)
+        {
+            spill(reg, true);
+        }
+        callAddress(function);
+        moveToXmm(_depth, RAX);
+        for (int reg = 0; reg < _depth; reg++)
+        {
+            spill(reg, false);
+        }
+    }
+
+    // mov rax, imm64; call rax
+    void callAddress(void* function)
+    {
+        uint64_t address = (uint64_t) function;
+        emit(0x48, 0xB8);
+        for (int i = 0; i < 8; i++)
+        {
+            emit((address >> (8 * i)) & 0xFF);
+        }
+        emit(0xFF, 0xD0);
+    }
+};
+
+} /* anonymous namespace */
+
+NativeCode* NativeCode::compile(Expression* expression)
+{
+    StatsTimer timer(COMPILE_STAGE);
+    TypeInference().infer(expression);
+    JitCompiler compiler;
+    if (!compiler.compile(expression))
+    {
+        return NULL;
+    }
+
+    const std::vector<unsigned char>& code = compiler.code();
+    void* memory = mmap(NULL, code.size(), PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        return NULL;
+    }
+    memcpy(memory, &code[0], code.size());
+    if (mprotect(memory, code.size(), PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(memory, code.size());
+        return NULL;
+    }
+    return new NativeCode(memory, code.size());
+}
+
+NativeCode::~NativeCode()
+{
+    munmap(_memory, _size);
+}
+
+#else
+
+NativeCode* NativeCode::compile(Expression*)
+{
+    return NULL;
+}
+
+NativeCode::~NativeCode()
+{
+}
+
+#endif /* DOPPIO_JIT */
+
+CompiledExpression::CompiledExpression(Expression* expression,
+        const Scope* scope) :
+        _native(NativeCode::compile(expression)), _function(NULL),
+        _bytecode(NULL), _interpreter(NULL)
+{
+    if (_native)
+    {
+        _function = _native->function();
+    }
+    else
+    {
+        _bytecode = BytecodeCompiler().compile(expression, scope);
+        if (_bytecode)
+        {
+            _interpreter = new Interpreter(_bytecode);
+            _environment.resize(scope->variableCount());
+        }
+    }
+}
+
+CompiledExpression::~CompiledExpression()
+{
+    delete _native;
+    delete _interpreter;
+    delete _bytecode;
+}
+
+double CompiledExpression::interpret(const double* variables)
+{
+    const std::vector<int>& reads = _bytecode->readVariables();
+    for (size_t i = 0; i < reads.size(); i++)
+    {
+        _environment[reads[i]] = Value(variables[reads[i]]);
+    }
+    return _interpreter->evaluate(_environment.data()).real();
+}
+
+} /* Doppio namespace */
@@ -0,0 +1,120 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_JIT_H_
+#define DOPPIO_JIT_H_
+
+#include <vector>
+#include "ast.h"
+#include "bytecode.h"
+#include "interpreter.h"
+#include "scope.h"
+
+namespace Doppio
+{
+
+typedef double (*NativeFunction)(const double* variables);
+
+// x86-64 machine code for one bound expression, in executable pages.
+// The code computes with SSE2 and reads variables from variables[slot].
+// Subexpressions that TypeInference finds to be integers, such as all of
+// a formula over integer literals and variables declared 'int' or 'long',
+// are computed in 64-bit integer arithmetic, with variables truncated as
+// they are loaded; everything else is computed in double precision.
+// Calls to built-ins, '^', real '%' and '!' go through ordinary C calls.
+class NativeCode
+{
+public:
+    // Returns NULL if the tree assigns to variables, takes the remainder
+    // of two integers by a divisor that may be zero, nests too deeply for
+    // the register stack or if the platform is not x86-64 System V.
+    static NativeCode* compile(Expression* expression);
+    ~NativeCode();
+
+    NativeFunction function() const
+    {
+        return (NativeFunction) _memory;
+    }
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+private:
+    void* _memory;
+    size_t _size;
+
+    NativeCode(void* memory, size_t size) :
+            _memory(memory), _size(size)
+    {
+    }
+
+    // Native code is not copyable.
+    NativeCode(const NativeCode&);
+    NativeCode& operator=(const NativeCode&);
+};
+
+// Evaluates a bound expression with native code when the JIT supports it
+// and falls back to the bytecode Interpreter otherwise.
+class CompiledExpression
+{
+public:
+    CompiledExpression(Expression* expression, const Scope* scope);
+    ~CompiledExpression();
+
+    bool isNative() const
+    {
+        return _native != NULL;
+    }
+
+    // False if the expression could be compiled neither to native code
+    // nor to bytecode, see BytecodeCompiler::compile(). It must not be
+    // evaluated then.
+    bool isValid() const
+    {
+        return _native != NULL || _interpreter != NULL;
+    }
+
+    double evaluate(const double* variables)
+    {
+        if (_native)
+        {
+            return _function(variables);
+        }
+        return interpret(variables);
+    }
+
+private:
+    NativeCode* _native;
+    NativeFunction _function;
+    Bytecode* _bytecode;
+    Interpreter* _interpreter;
+    std::vector<Value> _environment;
+
+    double interpret(const double* variables);
+
+    // Compiled expressions are not copyable.
+    CompiledExpression(const CompiledExpression&);
+    CompiledExpression& operator=(const CompiledExpression&);
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_JIT_H_ */
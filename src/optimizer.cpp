@@ -0,0 +1,437 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <cmath>
+#include "optimizer.h"
+#include "builtins.h"
+#include "typing.h"
+
+namespace Doppio
+{
+
+namespace
+{
+
+Value apply(Token::Type operation, const Value& left, const Value& right)
+{
+    switch (operation)
+    {
+    case Token::ADD:
+        return left + right;
+    case Token::SUB:
+        return left - right;
+    case Token::MUL:
+        return left * right;
+    case Token::DIV:
+        return left / right;
+    case Token::MOD:
+        return left % right;
+    case Token::POW:
+        return left ^ right;
+    default:
+        ASSERT(false);
+        return Value();
+    }
+}
+
+bool isConstant(Expression* node, long integer, double real)
+{
+    Number* number = node->asNumber();
+    if (!number)
+    {
+        return false;
+    }
+    return number->value().isInteger() ?
+            number->integer() == integer : number->real() == real;
+}
+
+bool isIntegerConstant(Expression* node, long integer)
+{
+    Number* number = node->asNumber();
+    return number && number->value().isInteger() && number->integer() == integer;
+}
+
+bool isRealConstant(Expression* node, double real)
+{
+    Number* number = node->asNumber();
+    return number && !number->value().isInteger() && number->real() == real;
+}
+
+// Matches +0.0 only: -0.0 is no identity of '-' and no annihilator that
+// gives +0.
+bool isRealZero(Expression* node)
+{
+    return isRealConstant(node, 0) && !std::signbit(node->asNumber()->real());
+}
+
+} /* anonymous namespace */
+
+Optimizer::Optimizer(Zone* zone, bool ieeeStrict) :
+        _zone(zone), _ieeeStrict(ieeeStrict), _rewriteCount(0), _result(NULL)
+{
+    _info.type = UNKNOWN_TYPE;
+    _info.pure = true;
+}
+
+Optimizer::~Optimizer()
+{
+}
+
+Expression* Optimizer::optimize(Expression* expression)
+{
+    _rewriteCount = 0;
+    _rewritten.clear();
+    _infos.clear();
+    Info info;
+    return rewrite(expression, &info);
+}
+
+Expression* Optimizer::rewrite(Expression* node, Info* info)
+{
+    // shared subtrees are rewritten once so the result stays a DAG
+    std::unordered_map<Expression*, Expression*>::iterator it =
+            _rewritten.find(node);
+    if (it != _rewritten.end())
+    {
+        *info = _infos[it->second];
+        return it->second;
+    }
+    visit(node);
+    _rewritten[node] = _result;
+    _infos[_result] = _info;
+    *info = _info;
+    return _result;
+}
+
+Expression* Optimizer::number(const Value& value, Info* info)
+{
+    info->type = value.isInteger() ? INTEGER_TYPE : REAL_TYPE;
+    info->pure = true;
+    Expression* result = new (_zone) Number(value);
+    _infos[result] = *info;
+    return result;
+}
+
+void Optimizer::visitAssignmentExpression(AssignmentExpression* node)
+{
+    Info info;
+    Expression* value = rewrite(node->value(), &info);
+    _result = value == node->value() ? node :
+            new (_zone) AssignmentExpression(node->operation(),
+                    node->target(), value);
+    _info.type = TypeInference::AssignmentType(
+            node->target()->asIdentifier(), info.type);
+    _info.pure = false;
+}
+
+void Optimizer::visitUnaryOperationExpression(UnaryOperationExpression* node)
+{
+    ASSERT(node->operation() == Token::FACTORIAL);
+    Info info;
+    Expression* expression = rewrite(node->expression(), &info);
+    if (expression->asNumber())
+    {
+        _rewriteCount++;
+        _result = number(Value::factorial(expression->asNumber()->value()),
+                &_info);
+        return;
+    }
+    _result = expression == node->expression() ? node :
+            new (_zone) UnaryOperationExpression(node->operation(),
+                    expression);
+    _info.type = INTEGER_TYPE;
+    _info.pure = info.pure;
+}
+
+void Optimizer::visitBinaryOperationExpression(BinaryOperationExpression* node)
+{
+    Info leftInfo, rightInfo;
+    Expression* left = rewrite(node->left(), &leftInfo);
+    Expression* right = rewrite(node->right(), &rightInfo);
+    Token::Type operation = node->operation();
+
+    Expression* result = simplify(operation, left, leftInfo, right,
+            rightInfo, &_info);
+    if (result)
+    {
+        _rewriteCount++;
+        _result = result;
+        return;
+    }
+
+    _result = left == node->left() && right == node->right() ? node :
+            new (_zone) BinaryOperationExpression(operation, left, right);
+    _info.pure = leftInfo.pure && rightInfo.pure;
+    _info.type = TypeInference::BinaryType(operation, leftInfo.type, right,
+            rightInfo.type);
+}
+
+void Optimizer::visitFunctionExpression(FunctionExpression* node)
+{
+    bool constant = true;
+    bool pure = true;
+    bool changed = false;
+    ZoneList<Expression*> arguments;
+    for (int i = 0; i < node->arguments().length(); i++)
+    {
+        Info info;
+        Expression* argument = rewrite(node->arguments()[i], &info);
+        arguments.add(argument, _zone);
+        constant = constant && argument->asNumber() != NULL;
+        pure = pure && info.pure;
+        changed = changed || argument != node->arguments()[i];
+    }
+
+    // the optimizer may run before the Binder
+    int builtin = node->builtin();
+    Identifier* callee = node->identifier()->asIdentifier();
+    if (builtin < 0 && callee)
+    {
+        builtin = Builtins::Lookup(callee->name(), callee->length());
+    }
+    if (constant && builtin >= 0
+            && Builtins::Arity((Builtins::Id) builtin) == arguments.length())
+    {
+        Value values[Builtins::kMaxArity];
+        for (int i = 0; i < arguments.length(); i++)
+        {
+            values[i] = arguments[i]->asNumber()->value();
+        }
+        _rewriteCount++;
+        _result = number(Builtins::Call((Builtins::Id) builtin, values),
+                &_info);
+        return;
+    }
+
+    if (changed)
+    {
+        FunctionExpression* call = new (_zone) FunctionExpression(
+                node->identifier(), arguments);
+        call->bind(node->builtin());
+        _result = call;
+    }
+    else
+    {
+        _result = node;
+    }
+    _info.type = REAL_TYPE;
+    _info.pure = pure && callee != NULL;
+}
+
+void Optimizer::visitIdentifier(Identifier* node)
+{
+    _result = node;
+    _info.type = node->staticType();
+    _info.pure = true;
+}
+
+void Optimizer::visitNumber(Number* node)
+{
+    _result = node;
+    _info.type = node->value().isInteger() ? INTEGER_TYPE : REAL_TYPE;
+    _info.pure = true;
+}
+
+// Returns the simplified form of left <operation> right, or NULL if there
+// is none.
+Expression* Optimizer::simplify(Token::Type operation, Expression* left,
+        const Info& leftInfo, Expression* right, const Info& rightInfo,
+        Info* info)
+{
+    if (left->asNumber() && right->asNumber())
+    {
+        return number(apply(operation, left->asNumber()->value(),
+                right->asNumber()->value()), info);
+    }
+    Expression* result = identity(operation, left, leftInfo, right,
+            rightInfo, info);
+    if (!result)
+    {
+        result = reassociate(operation, left, right, info);
+    }
+    return result;
+}
+
+Expression* Optimizer::identity(Token::Type operation, Expression* left,
+        const Info& leftInfo, Expression* right, const Info& rightInfo,
+        Info* info)
+{
+    switch (operation)
+    {
+    case Token::ADD:
+        // -0 + 0 is +0, so x+0 is x only for integers unless relaxed
+        if (isIntegerConstant(right, 0)
+                && (leftInfo.type == INTEGER_TYPE || !_ieeeStrict))
+        {
+            *info = leftInfo;
+            return left;
+        }
+        if (isIntegerConstant(left, 0)
+                && (rightInfo.type == INTEGER_TYPE || !_ieeeStrict))
+        {
+            *info = rightInfo;
+            return right;
+        }
+        if (!_ieeeStrict && isRealZero(right) && leftInfo.type == REAL_TYPE)
+        {
+            *info = leftInfo;
+            return left;
+        }
+        if (!_ieeeStrict && isRealZero(left) && rightInfo.type == REAL_TYPE)
+        {
+            *info = rightInfo;
+            return right;
+        }
+        break;
+    case Token::SUB:
+        // x-0 is x for every x, including -0, but -0-(-0) is +0
+        if (isIntegerConstant(right, 0)
+                || (isRealZero(right) && leftInfo.type == REAL_TYPE))
+        {
+            *info = leftInfo;
+            return left;
+        }
+        break;
+    case Token::MUL:
+        if (isIntegerConstant(right, 1)
+                || (isRealConstant(right, 1) && leftInfo.type == REAL_TYPE))
+        {
+            *info = leftInfo;
+            return left;
+        }
+        if (isIntegerConstant(left, 1)
+                || (isRealConstant(left, 1) && rightInfo.type == REAL_TYPE))
+        {
+            *info = rightInfo;
+            return right;
+        }
+        // NaN*0 is NaN and -1*0.0 is -0, so reals are annihilated only
+        // when relaxed
+        if ((isIntegerConstant(right, 0) || isRealZero(right))
+                && leftInfo.pure)
+        {
+            if (isIntegerConstant(right, 0) && leftInfo.type == INTEGER_TYPE)
+            {
+                return number(Value(0L), info);
+            }
+            if (!_ieeeStrict && leftInfo.type != UNKNOWN_TYPE)
+            {
+                return number(Value(0.0), info);
+            }
+        }
+        if ((isIntegerConstant(left, 0) || isRealZero(left))
+                && rightInfo.pure)
+        {
+            if (isIntegerConstant(left, 0) && rightInfo.type == INTEGER_TYPE)
+            {
+                return number(Value(0L), info);
+            }
+            if (!_ieeeStrict && rightInfo.type != UNKNOWN_TYPE)
+            {
+                return number(Value(0.0), info);
+            }
+        }
+        break;
+    case Token::DIV:
+        // an integer divided by 1 is still converted to a real
+        if (isConstant(right, 1, 1) && leftInfo.type == REAL_TYPE)
+        {
+            *info = leftInfo;
+            return left;
+        }
+        break;
+    case Token::POW:
+        if (isConstant(right, 1, 1) && leftInfo.type == REAL_TYPE)
+        {
+            *info = leftInfo;
+            return left;
+        }
+        // pow(x, 0) is 1 even for NaN
+        if (isConstant(right, 0, 0) && leftInfo.pure)
+        {
+            return number(Value(1.0), info);
+        }
+        break;
+    default:
+        break;
+    }
+    return NULL;
+}
+
+// Folds the constants of (x op c1) op c2 and c2 op (c1 op x) into
+// x op (c1 op c2) for op '+' or '*'. Wrapping integer arithmetic is
+// associative, so integer chains are always rewritten; chains that
+// involve reals round differently and are rewritten only when relaxed.
+Expression* Optimizer::reassociate(Token::Type operation, Expression* left,
+        Expression* right, Info* info)
+{
+    if (operation != Token::ADD && operation != Token::MUL)
+    {
+        return NULL;
+    }
+    Number* outer = right->asNumber();
+    Expression* inner = left;
+    if (!outer)
+    {
+        outer = left->asNumber();
+        inner = right;
+    }
+    BinaryOperationExpression* binary = inner->asBinaryOperationExpression();
+    if (!outer || !binary || binary->operation() != operation)
+    {
+        return NULL;
+    }
+    Number* constant = binary->right()->asNumber();
+    Expression* operand = binary->left();
+    if (!constant)
+    {
+        constant = binary->left()->asNumber();
+        operand = binary->right();
+    }
+    if (!constant)
+    {
+        return NULL;
+    }
+
+    Info operandInfo = _infos[operand];
+    if (_ieeeStrict && (operandInfo.type != INTEGER_TYPE
+            || !constant->value().isInteger() || !outer->value().isInteger()))
+    {
+        return NULL;
+    }
+
+    Info constantInfo;
+    Expression* folded = number(apply(operation, constant->value(),
+            outer->value()), &constantInfo);
+    Expression* result = identity(operation, operand, operandInfo, folded,
+            constantInfo, info);
+    if (result)
+    {
+        return result;
+    }
+    result = new (_zone) BinaryOperationExpression(operation, operand,
+            folded);
+    info->pure = operandInfo.pure;
+    info->type = operandInfo.type == REAL_TYPE
+            || constantInfo.type == REAL_TYPE ? REAL_TYPE : operandInfo.type;
+    _infos[result] = *info;
+    return result;
+}
+
+} /* Doppio namespace */
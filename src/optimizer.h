@@ -0,0 +1,92 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_OPTIMIZER_H_
+#define DOPPIO_OPTIMIZER_H_
+
+#include <unordered_map>
+#include "ast.h"
+
+namespace Doppio
+{
+
+// Constant folding and algebraic simplification over expression trees.
+//
+// The optimizer folds operators and pure built-in calls whose operands are
+// literals, removes identities (x*1, x+0, x-0, x/1, x^1), applies
+// annihilators (x*0, x^0) and reassociates constant chains such as
+// (2*x)*3 into x*6. It tracks which subtrees are statically integers or
+// reals, by the rules of TypeInference, and never changes the int/float
+// type of a result.
+//
+// In IEEE-strict mode, the default, only rewrites that give bitwise equal
+// results for every input are made: x+0 is kept for reals because of -0,
+// x*0 because of NaN, infinities and -0, and reals are not reassociated.
+// Subtrees that assign are never dropped.
+//
+// New nodes are allocated in the given zone; unchanged subtrees, including
+// shared ones, are kept as they are.
+class Optimizer: public AstVisitor<Optimizer>
+{
+public:
+    explicit Optimizer(Zone* zone, bool ieeeStrict = true);
+    ~Optimizer();
+
+    Expression* optimize(Expression* expression);
+
+    // Number of rewrites made by the last call to optimize().
+    int rewriteCount() const
+    {
+        return _rewriteCount;
+    }
+
+#define DECLARE_VISIT(type) void visit##type(type* node);
+    EXPRESSION_NODE_LIST(DECLARE_VISIT)
+#undef DECLARE_VISIT
+
+private:
+    struct Info
+    {
+        StaticType type;
+        bool pure;
+    };
+
+    Zone* _zone;
+    bool _ieeeStrict;
+    int _rewriteCount;
+    Expression* _result;
+    Info _info;
+    std::unordered_map<Expression*, Expression*> _rewritten;
+    std::unordered_map<Expression*, Info> _infos;
+
+    Expression* rewrite(Expression* node, Info* info);
+    Expression* number(const Value& value, Info* info);
+    Expression* simplify(Token::Type operation, Expression* left,
+            const Info& leftInfo, Expression* right, const Info& rightInfo,
+            Info* info);
+    Expression* identity(Token::Type operation, Expression* left,
+            const Info& leftInfo, Expression* right, const Info& rightInfo,
+            Info* info);
+    Expression* reassociate(Token::Type operation, Expression* left,
+            Expression* right, Info* info);
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_OPTIMIZER_H_ */
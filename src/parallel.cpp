@@ -0,0 +1,244 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <mutex>
+#include <thread>
+#include "parallel.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace Doppio
+{
+
+namespace
+{
+
+// Appends the positions of the marked characters of the block at
+// position.
+inline void addBoundaries(size_t position, uint32_t semicolons,
+        std::vector<size_t>* boundaries)
+{
+    while (semicolons)
+    {
+        boundaries->push_back(position + __builtin_ctz(semicolons));
+        semicolons &= semicolons - 1;
+    }
+}
+
+} /* anonymous namespace */
+
+// A thread's share of the batches. Batches are taken from the front by
+// the owner and stolen from the back by the others.
+class ParallelParser::Worker
+{
+public:
+    std::mutex mutex;
+    int next;
+    int end;
+    Zone zone;
+};
+
+ParallelParser::ParallelParser(const char* input, size_t length) :
+        _input(input), _length(length)
+{
+}
+
+ParallelParser::~ParallelParser()
+{
+    release();
+}
+
+void ParallelParser::Split(const char* input, size_t length,
+        std::vector<size_t>* semicolons)
+{
+    size_t position = 0;
+#if defined(__AVX2__)
+    for (; position + 32 <= length; position += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*) (input + position));
+        addBoundaries(position, (uint32_t) _mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8(';'))), semicolons);
+    }
+#endif
+#if defined(__SSE2__)
+    for (; position + 16 <= length; position += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*) (input + position));
+        addBoundaries(position, (uint32_t) _mm_movemask_epi8(
+                _mm_cmpeq_epi8(v, _mm_set1_epi8(';'))), semicolons);
+    }
+#endif
+    for (; position < length; position++)
+    {
+        if (input[position] == ';')
+        {
+            semicolons->push_back(position);
+        }
+    }
+}
+
+int ParallelParser::parse(int threads)
+{
+    release();
+
+    std::vector<size_t> semicolons;
+    Split(_input, _length, &semicolons);
+    size_t start = 0;
+    size_t batchStart = 0;
+    for (size_t i = 0; i <= semicolons.size(); i++)
+    {
+        size_t end = i < semicolons.size() ? semicolons[i] : _length;
+        if (start == batchStart)
+        {
+            _batches.push_back((int) _starts.size());
+        }
+        _starts.push_back(start);
+        _ends.push_back(end);
+        start = end + 1;
+        if (start - batchStart >= kBatchBytes)
+        {
+            batchStart = start;
+        }
+    }
+    int batches = (int) _batches.size();
+    _batches.push_back((int) _starts.size());
+
+    if (threads <= 0)
+    {
+        threads = (int) std::thread::hardware_concurrency();
+    }
+    if (threads > batches)
+    {
+        threads = batches;
+    }
+    if (threads < 1)
+    {
+        threads = 1;
+    }
+    for (int i = 0; i < threads; i++)
+    {
+        Worker* worker = new Worker;
+        worker->next = (int) ((long) batches * i / threads);
+        worker->end = (int) ((long) batches * (i + 1) / threads);
+        _workers.push_back(worker);
+    }
+
+    _statements.resize(_starts.size(), NULL);
+    std::vector<std::thread> helpers;
+    for (int i = 1; i < threads; i++)
+    {
+        helpers.push_back(std::thread(&ParallelParser::run, this, i,
+                SymbolTable::Current()));
+    }
+    run(0, SymbolTable::Current());
+    for (size_t i = 0; i < helpers.size(); i++)
+    {
+        helpers[i].join();
+    }
+
+    // drop the empty statements, keeping the order
+    int count = 0;
+    for (size_t i = 0; i < _statements.size(); i++)
+    {
+        if (_statements[i])
+        {
+            _statements[count] = _statements[i];
+            _offsets.push_back(_starts[i]);
+            count++;
+        }
+    }
+    _statements.resize(count);
+    return count;
+}
+
+void ParallelParser::run(int self, SymbolTable* symbols)
+{
+    SymbolTableScope scope(symbols);
+    Parser parser(NULL, 0, &_workers[self]->zone);
+    int batch;
+    while (take(self, &batch) || (steal(self) && take(self, &batch)))
+    {
+        for (int i = _batches[batch]; i < _batches[batch + 1]; i++)
+        {
+            parser.reset(_input + _starts[i], _ends[i] - _starts[i]);
+            _statements[i] = parser.parseStatement();
+        }
+    }
+}
+
+// Takes the next batch of the thread's own share.
+bool ParallelParser::take(int self, int* batch)
+{
+    Worker* worker = _workers[self];
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    if (worker->next == worker->end)
+    {
+        return false;
+    }
+    *batch = worker->next++;
+    return true;
+}
+
+// Moves the back half of the remaining batches of another thread to the
+// thread's own share. Returns false once no thread has batches left.
+bool ParallelParser::steal(int self)
+{
+    int threads = (int) _workers.size();
+    for (int i = 1; i < threads; i++)
+    {
+        Worker* victim = _workers[(self + i) % threads];
+        int first;
+        int last;
+        {
+            std::lock_guard<std::mutex> lock(victim->mutex);
+            int remaining = victim->end - victim->next;
+            if (remaining == 0)
+            {
+                continue;
+            }
+            last = victim->end;
+            first = last - (remaining + 1) / 2;
+            victim->end = first;
+        }
+        Worker* worker = _workers[self];
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->next = first;
+        worker->end = last;
+        return true;
+    }
+    return false;
+}
+
+void ParallelParser::release()
+{
+    for (size_t i = 0; i < _workers.size(); i++)
+    {
+        delete _workers[i];
+    }
+    _workers.clear();
+    _starts.clear();
+    _ends.clear();
+    _batches.clear();
+    _statements.clear();
+    _offsets.clear();
+}
+
+} /* Doppio namespace */
@@ -0,0 +1,104 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_PARALLEL_H_
+#define DOPPIO_PARALLEL_H_
+
+#include <vector>
+#include "parser.h"
+
+namespace Doppio
+{
+
+// Parses a program of ';'-separated statements on several threads.
+//
+// The input is split at every ';', which no statement contains, so a
+// syntax error such as an unbalanced '(' stays in its own statement as
+// with ProgramParser. The statements are grouped into batches of about
+// kBatchBytes. Each thread starts on an equal share of the batches and
+// steals half of the remaining batches of another thread once its own
+// share is done. Every thread has its own Parser and Zone, identifiers go
+// to the SymbolTable::Current() of the calling thread. Statements are
+// stored by index, so they come out in source order.
+class ParallelParser
+{
+public:
+    static const size_t kBatchBytes = 64 * 1024;
+
+    // The input must outlive the parser.
+    ParallelParser(const char* input, size_t length);
+    ~ParallelParser();
+
+    // Parses the whole input with the given number of threads, 0 for one
+    // per hardware thread. Trees of a previous parse are released.
+    // Returns the number of statements, empty ones are left out.
+    int parse(int threads = 0);
+
+    int length() const
+    {
+        return (int) _statements.size();
+    }
+
+    // A statement with syntax errors has no expression. Parsing its text
+    // again with a Parser gives the diagnostics.
+    ExpressionStatement* at(int i) const
+    {
+        return _statements[i];
+    }
+
+    // Offset in the input of the text of statement i. Token offsets
+    // within a statement are relative to it.
+    size_t statementOffset(int i) const
+    {
+        return _offsets[i];
+    }
+
+    // Appends the offsets of the ';' in input in increasing order.
+    static void Split(const char* input, size_t length,
+            std::vector<size_t>* semicolons);
+
+private:
+    class Worker;
+
+    const char* _input;
+    size_t _length;
+
+    // Statement i is [_starts[i], _ends[i]), batch k is the statements
+    // from _batches[k] up to _batches[k + 1].
+    std::vector<size_t> _starts;
+    std::vector<size_t> _ends;
+    std::vector<int> _batches;
+
+    std::vector<Worker*> _workers;
+    std::vector<ExpressionStatement*> _statements;
+    std::vector<size_t> _offsets;
+
+    void run(int self, SymbolTable* symbols);
+    bool take(int self, int* batch);
+    bool steal(int self);
+    void release();
+
+    // Parsers are not copyable.
+    ParallelParser(const ParallelParser&);
+    ParallelParser& operator=(const ParallelParser&);
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_PARALLEL_H_ */
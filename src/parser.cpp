@@ -1,229 +1,684 @@
-/*
- * Licensed to the Apache Software Foundation (ASF) under one
- * or more contributor license agreements.  See the NOTICE file
- * distributed with this work for additional information
- * regarding copyright ownership.  The ASF licenses this file
- * to you under the Apache License, Version 2.0 (the
- * "License"); you may not use this file except in compliance
- * with the License.  You may obtain a copy of the License at
- *
- * http://www.apache.org/licenses/LICENSE-2.0
- *
- * Unless required by applicable law or agreed to in writing,
- * software distributed under the License is distributed on an
- * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
- * KIND, either express or implied.  See the License for the
- * specific language governing permissions and limitations
- * under the License.
- */
-
-#include "parser.h"
-
-namespace Doppio
-{
-
-Parser::Parser(const char *input, size_t length) :
-        Scanner(input, length)
-{
-}
-
-Parser::~Parser()
-{
-}
-
-void Parser::expect(Token::Type expectedToken)
-{
-    if (next() != expectedToken)
-    {
-        unexpectedToken();
-    }
-}
-
-void Parser::unexpectedToken()
-{
-    // TODO 
-    printf("unexpected token: %s", Token::Name(current()));
-    exit(0);
-}
-
-void Parser::error(const char *msg)
-{
-    // TODO 
-    printf(msg);
-    exit(0);
-}
-
-Expression* Parser::parseExpression()
-{
-    /*
-     * expression:   assignment_expression;
-     */
-    return parseAssignmentExpression();
-}
-
-Expression* Parser::parseAssignmentExpression()
-{
-    /*
-     * assignment_expression:   additive_expression ('=' assignment_expression)*;
-     */
-    Expression* result = parseBinaryExpression(4);
-    while (peek() == Token::ASSIGN)
-    {
-        Token::Type operation = next();
-        Expression* right = parseAssignmentExpression();
-        result = new AssignmentExpression(operation, result, right);
-    }
-    return result;
-}
-
-Expression* Parser::parseBinaryExpression(int prec)
-{
-    /*
-     * additive_expression:
-     *      (multiplicative_expression) ('+' multiplicative_expression | '-' multiplicative_expression)*
-     *
-     * multiplicative_expression:
-     *      (postfix_expression) ('*' postfix_expression | '/' postfix_expression | '%' postfix_expression | '^' postfix_expression)*
-     */
-    ASSERT(prec >= 4);
-    Expression* result = parsePostfixExpression();
-    for (int prec1 = Token::Precedence(peek()); prec1 >= prec; prec1--)
-    {
-        while (Token::Precedence(peek()) == prec1)
-        {
-            Token::Type operation = next();
-            Expression* right = parseBinaryExpression(prec1 + 1);
-            if (result && result->isConstant() && right && right->isConstant())
-            {
-                Number* x = (Number *) result;
-                Number* y = (Number *) right;
-                switch (operation)
-                {
-                case Token::ADD:
-                    result = *x + *y;
-                    break;
-                case Token::SUB:
-                    result = *x - *y;
-                    break;
-                case Token::MUL:
-                    result = *x * *y;
-                    break;
-                case Token::DIV:
-                    result = *x / *y;
-                    break;
-                case Token::MOD:
-                    result = *x % *y;
-                    break;
-                case Token::POW:
-                    result = *x ^ *y;
-                    break;
-                default:
-                    break;
-                }
-                delete x;
-                delete y;
-            }
-            else
-            {
-                result = new BinaryOperationExpression(operation, result,
-                        right);
-            }
-        }
-    }
-    return result;
-}
-
-Expression* Parser::parsePostfixExpression()
-{
-    /* postfix_expression:
-     *      primary_expression ( arguments_expression | '!' )*;
-     */
-    Expression* result = parsePrimaryExpression();
-    while (true)
-    {
-        switch (peek())
-        {
-        case Token::LPAREN:
-            result = new FunctionExpression(result, parseArgumentsExpression());
-            break;
-        case Token::FACTORIAL:
-            if (result->isConstant())
-            {
-                // TODO      -   
-                if (current() == Token::NUMBER_INTEGER)
-                {
-                    // TODO         
-                    long val = 1;
-                    for (int i = 2; i <= ((Number *)result)->integer(); i++)
-                    {
-                        val *= i;
-                    }
-                    delete result;
-                    result = new Number(val);
-                }
-                else
-                {
-                    error("Factorial can be calculated only for integers");
-                }
-            }
-            else
-            {
-                result = new UnaryOperationExpression(Token::FACTORIAL, result);
-            }
-            next();
-            break;
-        default:
-            return result;
-        }
-    }
-    return NULL; // make compiler happy
-}
-
-Expression* Parser::parsePrimaryExpression()
-{
-    /*
-     * primary_expression: IDENTIFIER | INT | FLOAT | '(' expression ')'
-     */
-    next();
-    Token token = currentToken();
-    switch (token.type)
-    {
-    case Token::IDENTIFIER:
-        return new Identifier(std::string(_beg + token.start, _beg + token.end));
-    case Token::NUMBER_FLOAT:
-        return new Number(strtod(_beg + token.start, NULL));
-    case Token::NUMBER_INTEGER:
-        return new Number(strtol(_beg + token.start, NULL, 10));
-    case Token::LPAREN:
-        return parseExpression();
-    default:
-        unexpectedToken();
-        break;
-    }
-    return NULL; // make compiler happy
-}
-
-std::vector<Expression*> Parser::parseArgumentsExpression()
-{
-    /*
-     * arguments_expression:  '(' assignment_expression (',' assignment_expression)* ')' | '(' ')';
-     */
-    std::vector<Expression*> args;
-    bool done = (peek() == Token::RPAREN);
-    expect(Token::LPAREN);
-    while (!done)
-    {
-        Expression* argument = parseAssignmentExpression();
-        args.push_back(argument);
-        done = (peek() == Token::RPAREN);
-        // TODO check if too many arguments
-        if (!done)
-        {
-            expect(Token::COMMA);
-        }
-    }
-    expect(Token::RPAREN);
-    return args;
-}
-
-} /* Doppio namespace */
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "parser.h"
+#include "incremental.h"
+#include "profiler.h"
+#include "stats.h"
+
+namespace Doppio
+{
+
+namespace
+{
+
+static_assert(Token::NUM_TOKENS <= 64, "token sets are 64-bit masks");
+
+constexpr uint64_t bit(Token::Type type)
+{
+    return (uint64_t) 1 << type;
+}
+
+// Tokens that may start an operand.
+const uint64_t kOperandTokens = bit(Token::IDENTIFIER)
+        | bit(Token::NUMBER_INTEGER) | bit(Token::NUMBER_FLOAT)
+        | bit(Token::LPAREN);
+
+// Tokens that may start a declaration, and the type names among them.
+const uint64_t kTypeTokens = bit(Token::INT) | bit(Token::LONG)
+        | bit(Token::FLOAT) | bit(Token::DOUBLE);
+const uint64_t kDeclarationTokens = kTypeTokens | bit(Token::CONST);
+
+// Tokens that may follow an operand inside an expression.
+const uint64_t kOperatorTokens = bit(Token::ADD) | bit(Token::SUB)
+        | bit(Token::MUL) | bit(Token::DIV) | bit(Token::MOD)
+        | bit(Token::POW) | bit(Token::ASSIGN) | bit(Token::FACTORIAL)
+        | bit(Token::LPAREN);
+
+// Returns a node just allocated by the parser, counting it in Stats.
+template<typename T>
+T* counted(T* node)
+{
+    Stats::CountNode(node->nodeType());
+    return node;
+}
+
+// Adds the time and the zone bytes of one parse to Stats.
+class ParseStats
+{
+public:
+    explicit ParseStats(Zone* zone) :
+            _timer(PARSE_STAGE), _zone(zone), _size(zone->allocationSize())
+    {
+    }
+
+    ~ParseStats()
+    {
+        Stats::CountBytes(_zone->allocationSize() - _size);
+    }
+
+private:
+    StatsTimer _timer;
+    Zone* _zone;
+    size_t _size;
+};
+
+} /* anonymous namespace */
+
+Parser::Parser(const char *input, size_t length, Zone* zone) :
+        Scanner(input, length), _zone(zone), _operandTable(NULL),
+        _operandStart(0), _sourceMap(NULL)
+{
+    _operands.reserve(kInitialStackDepth);
+    _frames.reserve(kInitialStackDepth);
+}
+
+Parser::Parser(const TokenBuffer* tokens, Zone* zone) :
+        Scanner(tokens), _zone(zone), _operandTable(NULL), _operandStart(0),
+        _sourceMap(NULL)
+{
+    _operands.reserve(kInitialStackDepth);
+    _frames.reserve(kInitialStackDepth);
+}
+
+Parser::~Parser()
+{
+}
+
+void Parser::reset(const char* input, size_t length)
+{
+    Scanner::reset(input, length);
+}
+
+void Parser::addDiagnostic(const Token& token, const char* message,
+        uint64_t expected)
+{
+    Diagnostic diagnostic;
+    diagnostic.message = message;
+    diagnostic.token = token.type;
+    diagnostic.start = token.start;
+    diagnostic.end = token.end;
+    diagnostic.expected = expected;
+    _diagnostics.push_back(diagnostic);
+}
+
+// Reports the next token, which is left unconsumed.
+void Parser::unexpectedToken(uint64_t expected)
+{
+    addDiagnostic(peekToken(), "unexpected token", expected);
+}
+
+// Panic mode after an error: skips tokens up to a ';', the end of the
+// input or the ')' closing the innermost group or call. That group or call
+// is then replaced by an invalid operand, NULL, and false is returned only
+// if the expression cannot be continued.
+bool Parser::recover()
+{
+    int group = (int) _frames.size() - 1;
+    while (group >= 0 && _frames[group].kind != Frame::GROUP
+            && _frames[group].kind != Frame::CALL)
+    {
+        group--;
+    }
+    int depth = 0;
+    while (true)
+    {
+        Token::Type type = peek();
+        if (type == Token::EOS || (type == Token::SEMICOLON && depth == 0)
+                || (type == Token::RPAREN && depth == 0 && group >= 0))
+        {
+            break;
+        }
+        if (type == Token::LPAREN)
+        {
+            depth++;
+        }
+        else if (type == Token::RPAREN && depth > 0)
+        {
+            depth--;
+        }
+        next();
+    }
+    if (peek() != Token::RPAREN)
+    {
+        _frames.clear();
+        _operands.clear();
+        return false;
+    }
+    next();
+    _operands.resize(_frames[group].operandBase);
+    _operands.push_back(NULL);
+    _frames.resize(group);
+    return true;
+}
+
+ParseResult Parser::parse()
+{
+    Expression* expression = parseExpression();
+    if (peek() != Token::EOS)
+    {
+        if (_diagnostics.empty())
+        {
+            unexpectedToken(kOperatorTokens | bit(Token::EOS));
+        }
+        expression = NULL;
+    }
+    ParseResult result;
+    result.expression = expression;
+    result.diagnostics = diagnostics();
+    result.diagnosticCount = diagnosticCount();
+    return result;
+}
+
+Expression* Parser::parseExpression()
+{
+    /*
+     * expression:   declaration | assignment_expression;
+     *
+     * declaration:   'const'? type? IDENTIFIER ('=' assignment_expression)?;
+     *
+     * type:   'int' | 'long' | 'float' | 'double';
+     *
+     * assignment_expression:   additive_expression ('=' assignment_expression)*;
+     *
+     * additive_expression:
+     *      (multiplicative_expression) ('+' multiplicative_expression | '-' multiplicative_expression)*
+     *
+     * multiplicative_expression:
+     *      (postfix_expression) ('*' postfix_expression | '/' postfix_expression | '%' postfix_expression | '^' postfix_expression)*
+     *
+     * postfix_expression:
+     *      primary_expression ( arguments_expression | '!' )*;
+     *
+     * arguments_expression:  '(' assignment_expression (',' assignment_expression)* ')' | '(' ')';
+     *
+     * primary_expression: IDENTIFIER | INT | FLOAT | '(' expression ')'
+     */
+    ParseStats stats(_zone);
+    _operands.clear();
+    _frames.clear();
+    _diagnostics.clear();
+    if (kDeclarationTokens & bit(peek()))
+    {
+        // the declaration is the left side of the expression's one
+        // assignment, if any
+        bool constant = peek() == Token::CONST;
+        size_t start = peekToken().start;
+        Identifier* identifier = parseDeclaration();
+        if (identifier == NULL)
+        {
+            recover();
+            return NULL;
+        }
+        mapSource(identifier, start);
+        if (peek() != Token::ASSIGN)
+        {
+            if (constant || (kOperatorTokens & bit(peek())))
+            {
+                unexpectedToken(bit(Token::ASSIGN)
+                        | (constant ? 0 : bit(Token::SEMICOLON)
+                                | bit(Token::EOS)));
+                recover();
+                return NULL;
+            }
+            return identifier;
+        }
+        next();
+        _operands.push_back(identifier);
+        pushFrame(Frame::ASSIGNMENT,
+                constant ? Token::INIT_CONST : Token::INIT_VAR, 0);
+    }
+    bool expectOperand = true;
+    while (true)
+    {
+        if (expectOperand)
+        {
+            if (_operandTable && reuseOperand())
+            {
+                expectOperand = false;
+                continue;
+            }
+            if (peek() == Token::LPAREN)
+            {
+                if (_operandTable)
+                {
+                    _operandStart = tokenIndex();
+                }
+                next();
+                pushFrame(Frame::GROUP, Token::LPAREN, 0);
+                _frames.back().position = currentToken().start;
+                continue;
+            }
+            if (!(kOperandTokens & bit(peek())))
+            {
+                unexpectedToken(kOperandTokens
+                        | (_operands.empty() && _frames.empty() ?
+                                kDeclarationTokens : 0));
+                if (!recover())
+                {
+                    return NULL;
+                }
+                expectOperand = false;
+                continue;
+            }
+            if (_operandTable)
+            {
+                _operandStart = tokenIndex();
+            }
+            _operands.push_back(parsePrimaryExpression());
+            mapSource(_operands.back(), currentToken().start);
+            expectOperand = false;
+            continue;
+        }
+
+        Token::Type operation = peek();
+        int precedence = Token::Precedence(operation);
+        if (precedence >= kBinaryPrecedence)
+        {
+            // operators of equal precedence associate to the left
+            reduce(precedence);
+            pushFrame(Frame::BINARY, operation, precedence);
+            next();
+            expectOperand = true;
+            continue;
+        }
+
+        switch (operation)
+        {
+        case Token::ASSIGN:
+            // assignments associate to the right
+            reduce(kBinaryPrecedence);
+            pushFrame(Frame::ASSIGNMENT, operation, 0);
+            next();
+            expectOperand = true;
+            continue;
+        case Token::FACTORIAL:
+        {
+            next();
+            Expression* operand = _operands.back();
+            _operands.back() = parseFactorialExpression(operand);
+            mapSource(_operands.back(), operand);
+            continue;
+        }
+        case Token::LPAREN:
+            next();
+            pushFrame(Frame::CALL, operation, 0);
+            _frames.back().callee = _operands.back();
+            _operands.pop_back();
+            _frames.back().operandBase = _operands.size();
+            if (peek() == Token::RPAREN)
+            {
+                next();
+                reduceFunctionExpression();
+                continue;
+            }
+            expectOperand = true;
+            continue;
+        default:
+            break;
+        }
+
+        // the end of a group, an argument or the whole expression
+        reduce(0);
+        if (_frames.empty())
+        {
+            ASSERT(_operands.size() == 1);
+            return _diagnostics.empty() ? _operands.back() : NULL;
+        }
+        Frame::Kind kind = _frames.back().kind;
+        if (kind == Frame::GROUP && operation == Token::RPAREN)
+        {
+            next();
+            mapSource(_operands.back(), _frames.back().position);
+            recordOperand(_frames.back().start);
+            _frames.pop_back();
+            continue;
+        }
+        if (kind == Frame::CALL && operation == Token::RPAREN)
+        {
+            next();
+            reduceFunctionExpression();
+            continue;
+        }
+        if (kind == Frame::CALL && operation == Token::COMMA)
+        {
+            // TODO check if too many arguments
+            next();
+            expectOperand = true;
+            continue;
+        }
+        unexpectedToken(kOperatorTokens | bit(Token::RPAREN)
+                | (kind == Frame::CALL ? bit(Token::COMMA) : 0));
+        if (!recover())
+        {
+            return NULL;
+        }
+    }
+}
+
+ExpressionStatement* Parser::parseStatement()
+{
+    /*
+     * statement:   expression (';' | EOS) | ';';
+     */
+    while (peek() == Token::SEMICOLON)
+    {
+        next();
+    }
+    if (peek() == Token::EOS)
+    {
+        return NULL;
+    }
+    Expression* expression = parseExpression();
+    if (peek() != Token::SEMICOLON && peek() != Token::EOS)
+    {
+        if (_diagnostics.empty())
+        {
+            unexpectedToken(kOperatorTokens | bit(Token::SEMICOLON)
+                    | bit(Token::EOS));
+        }
+        expression = NULL;
+        while (peek() != Token::SEMICOLON && peek() != Token::EOS)
+        {
+            next();
+        }
+    }
+    if (peek() == Token::SEMICOLON)
+    {
+        next();
+    }
+    return counted(new (_zone) ExpressionStatement(expression));
+}
+
+void Parser::pushFrame(Frame::Kind kind, Token::Type operation,
+        int precedence)
+{
+    Frame frame;
+    frame.kind = kind;
+    frame.operation = operation;
+    frame.precedence = precedence;
+    frame.callee = NULL;
+    frame.operandBase = _operands.size();
+    frame.start = _operandStart;
+    frame.position = 0;
+    _frames.push_back(frame);
+}
+
+// Completes pending binary operators of at least the given precedence.
+// Precedence 0 completes assignments too, up to the innermost group or
+// call.
+void Parser::reduce(int precedence)
+{
+    while (!_frames.empty())
+    {
+        const Frame& frame = _frames.back();
+        if (frame.kind == Frame::BINARY && frame.precedence >= precedence)
+        {
+            reduceBinaryExpression();
+        }
+        else if (frame.kind == Frame::ASSIGNMENT && precedence == 0)
+        {
+            reduceAssignmentExpression();
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+void Parser::reduceBinaryExpression()
+{
+    Token::Type operation = _frames.back().operation;
+    int precedence = _frames.back().precedence;
+    int start = _frames.back().start;
+    _frames.pop_back();
+    Expression* right = _operands.back();
+    _operands.pop_back();
+    Expression* result = _operands.back();
+    if (result == NULL || right == NULL)
+    {
+        _operands.back() = NULL;
+    }
+    else if (result->isConstant() && right->isConstant())
+    {
+        // fold in place, the right operand is released with the zone
+        Stats::CountFold();
+        Number* x = result->asNumber();
+        Number* y = right->asNumber();
+        switch (operation)
+        {
+        case Token::ADD:
+            *x = *x + *y;
+            break;
+        case Token::SUB:
+            *x = *x - *y;
+            break;
+        case Token::MUL:
+            *x = *x * *y;
+            break;
+        case Token::DIV:
+            *x = *x / *y;
+            break;
+        case Token::MOD:
+            *x = *x % *y;
+            break;
+        case Token::POW:
+            *x = *x ^ *y;
+            break;
+        default:
+            break;
+        }
+    }
+    else
+    {
+        _operands.back() = counted(new (_zone) BinaryOperationExpression(
+                operation, result, right));
+    }
+    mapSource(_operands.back(), result);
+    if (_operandTable)
+    {
+        // the expression ends before the token that completed it
+        _operandStart = start;
+        _operandTable->record(start, tokenIndex(), _operands.back(),
+                precedence);
+    }
+}
+
+void Parser::reduceAssignmentExpression()
+{
+    Token::Type operation = _frames.back().operation;
+    _frames.pop_back();
+    Expression* value = _operands.back();
+    _operands.pop_back();
+    if (_operands.back() == NULL || value == NULL)
+    {
+        _operands.back() = NULL;
+        return;
+    }
+    Expression* target = _operands.back();
+    _operands.back() = counted(new (_zone) AssignmentExpression(operation,
+            target, value));
+    mapSource(_operands.back(), target);
+}
+
+void Parser::reduceFunctionExpression()
+{
+    Frame call = _frames.back();
+    _frames.pop_back();
+    bool valid = call.callee != NULL;
+    ZoneList<Expression*> arguments;
+    for (size_t i = call.operandBase; i < _operands.size(); i++)
+    {
+        valid = valid && _operands[i] != NULL;
+        arguments.add(_operands[i], _zone);
+    }
+    _operands.resize(call.operandBase);
+    _operands.push_back(valid ? counted(new (_zone) FunctionExpression(
+            call.callee, arguments)) : NULL);
+    mapSource(_operands.back(), call.callee);
+    recordOperand(call.start);
+}
+
+// Takes the operand starting at the next token from the OperandTable, if
+// it holds one that the pending operator does not split.
+bool Parser::reuseOperand()
+{
+    int start = tokenIndex();
+    int end;
+    int precedence = _frames.empty() ? 0 : _frames.back().precedence;
+    Expression* operand = _operandTable->find(start, precedence, &end);
+    if (operand == NULL)
+    {
+        return false;
+    }
+    seekToken(end);
+    _operands.push_back(operand);
+    _operandStart = start;
+    return true;
+}
+
+// Records the group or call just completed, which is the last operand and
+// ends before the next token.
+void Parser::recordOperand(int start)
+{
+    if (_operandTable)
+    {
+        _operandStart = start;
+        _operandTable->record(start, tokenIndex(), _operands.back(),
+                OperandTable::kPrimaryPrecedence);
+    }
+}
+
+// With a SourceMap, records that node, which may be NULL, spans the text
+// from start up to the end of the current token.
+void Parser::mapSource(const Expression* node, size_t start)
+{
+    if (_sourceMap && node)
+    {
+        _sourceMap->set(node, start, currentToken().end);
+    }
+}
+
+// As above, from the start of the range of first, the leftmost operand of
+// node. A folded constant is its own first operand.
+void Parser::mapSource(const Expression* node, const Expression* first)
+{
+    if (_sourceMap && node)
+    {
+        const SourceRange* range = _sourceMap->find(first);
+        if (range)
+        {
+            mapSource(node, range->start);
+        }
+    }
+}
+
+Expression* Parser::parseFactorialExpression(Expression* result)
+{
+    if (result == NULL)
+    {
+        return NULL;
+    }
+    Number* number = result->asNumber();
+    if (number)
+    {
+        // TODO      -   
+        if (number->type() == Token::NUMBER_INTEGER)
+        {
+            // TODO         
+            *number = Number(Value::factorial(number->value()));
+            Stats::CountFold();
+        }
+        else
+        {
+            addDiagnostic(currentToken(),
+                    "Factorial can be calculated only for integers", 0);
+            return NULL;
+        }
+    }
+    else
+    {
+        result = counted(new (_zone) UnaryOperationExpression(
+                Token::FACTORIAL, result));
+    }
+    return result;
+}
+
+// Parses a declaration up to its name and returns the declared
+// identifier, or NULL after reporting an error.
+Identifier* Parser::parseDeclaration()
+{
+    bool constant = peek() == Token::CONST;
+    if (constant)
+    {
+        next();
+    }
+    StaticType type = UNKNOWN_TYPE;
+    switch (peek())
+    {
+    case Token::INT:
+    case Token::LONG:
+        type = INTEGER_TYPE;
+        next();
+        break;
+    case Token::FLOAT:
+    case Token::DOUBLE:
+        type = REAL_TYPE;
+        next();
+        break;
+    default:
+        break;
+    }
+    if (peek() != Token::IDENTIFIER)
+    {
+        unexpectedToken(bit(Token::IDENTIFIER)
+                | (type == UNKNOWN_TYPE ? kTypeTokens : 0));
+        return NULL;
+    }
+    next();
+    return counted(new (_zone) Identifier(currentToken().symbol, type));
+}
+
+Expression* Parser::parsePrimaryExpression()
+{
+    /*
+     * primary_expression: IDENTIFIER | INT | FLOAT
+     *
+     * Parenthesized expressions and errors are handled by
+     * parseExpression().
+     */
+    next();
+    Token token = currentToken();
+    switch (token.type)
+    {
+    case Token::IDENTIFIER:
+        return counted(new (_zone) Identifier(token.symbol));
+    case Token::NUMBER_FLOAT:
+        return counted(new (_zone) Number(token.real));
+    case Token::NUMBER_INTEGER:
+        return counted(new (_zone) Number(token.integer));
+    default:
+        ASSERT(false);
+        break;
+    }
+    return NULL; // make compiler happy
+}
+
+} /* Doppio namespace */
@@ -1,53 +1,195 @@
-/*
- * Licensed to the Apache Software Foundation (ASF) under one
- * or more contributor license agreements.  See the NOTICE file
- * distributed with this work for additional information
- * regarding copyright ownership.  The ASF licenses this file
- * to you under the Apache License, Version 2.0 (the
- * "License"); you may not use this file except in compliance
- * with the License.  You may obtain a copy of the License at
- *
- * http://www.apache.org/licenses/LICENSE-2.0
- *
- * Unless required by applicable law or agreed to in writing,
- * software distributed under the License is distributed on an
- * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
- * KIND, either express or implied.  See the License for the
- * specific language governing permissions and limitations
- * under the License.
- */
-
-#ifndef DOPPIO_PARSER_H_
-#define DOPPIO_PARSER_H_
-
-#include "ast.h"
-#include "scanner.h"
-
-namespace Doppio
-{
-
-class Parser : protected Scanner
-{
-private:
-    void expect(Token::Type token);
-    void unexpectedToken();
-    void error(const char *msg);
-
-    Expression* parseAssignmentExpression();
-    Expression* parseBinaryExpression(int prec);
-    Expression* parseAdditiveExpression();
-    Expression* parseMultiplicativeExpression();
-    Expression* parsePostfixExpression();
-    Expression* parsePrimaryExpression();
-    std::vector<Expression*> parseArgumentsExpression();
-
-public:
-	Parser(const char *input, size_t length);
-	virtual ~Parser();
-
-    Expression* parseExpression();
-};
-
-} /* Doppio namespace */
-
-#endif /* DOPPIO_PARSER_H_ */
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_PARSER_H_
+#define DOPPIO_PARSER_H_
+
+#include <vector>
+#include "ast.h"
+#include "scanner.h"
+#include "tokens.h"
+
+namespace Doppio
+{
+
+class OperandTable;
+class SourceMap;
+
+// A syntax error. The offsets are those of the offending token.
+struct Diagnostic
+{
+    const char* message;
+    Token::Type token;
+    size_t start;
+    size_t end;
+
+    // Bit 1 << type is set for every token type that was acceptable in
+    // place of the offending token. Zero if the error is not about an
+    // unexpected token.
+    uint64_t expected;
+
+    bool isExpected(Token::Type type) const
+    {
+        return (expected >> type) & 1;
+    }
+};
+
+// The outcome of Parser::parse(). The diagnostics belong to the parser and
+// stay valid until it parses again.
+struct ParseResult
+{
+    // NULL if there are diagnostics.
+    Expression* expression;
+    const Diagnostic* diagnostics;
+    int diagnosticCount;
+
+    bool succeeded() const
+    {
+        return diagnosticCount == 0;
+    }
+};
+
+// Parses expressions with operator precedence, driven by
+// Token::Precedence(). The parser does not recurse: pending operators,
+// parentheses and calls are kept on a stack on the heap, so nesting depth
+// is limited by memory only.
+//
+// Syntax errors never abort: they are recorded as Diagnostics, and the
+// parser skips ahead to the next ';' or to the ')' closing the innermost
+// group or call and goes on from there. A tree with errors is not
+// returned.
+class Parser : protected Scanner
+{
+private:
+    // Lowest precedence of a binary operator, assignments and commas
+    // bind weaker.
+    static const int kBinaryPrecedence = 4;
+    static const size_t kInitialStackDepth = 16;
+
+    // A pending construct whose right side is still being parsed.
+    struct Frame
+    {
+        enum Kind
+        {
+            BINARY, ASSIGNMENT, GROUP, CALL
+        };
+
+        Kind kind;
+        Token::Type operation;
+        int precedence;
+
+        // The callee of a CALL. The operands of the frame, the arguments
+        // of a CALL, are those from operandBase up.
+        Expression* callee;
+        size_t operandBase;
+
+        // With an OperandTable, the index of the first token of a GROUP
+        // or CALL, or of the left operand of a BINARY.
+        int start;
+
+        // With a SourceMap, the offset of the '(' of a GROUP.
+        size_t position;
+    };
+
+    Zone* _zone;
+    std::vector<Expression*> _operands;
+    std::vector<Frame> _frames;
+    std::vector<Diagnostic> _diagnostics;
+
+    // With an OperandTable, the index of the first token of the last
+    // operand.
+    OperandTable* _operandTable;
+    int _operandStart;
+
+    SourceMap* _sourceMap;
+
+    void addDiagnostic(const Token& token, const char* message,
+            uint64_t expected);
+    void unexpectedToken(uint64_t expected);
+    bool recover();
+
+    void pushFrame(Frame::Kind kind, Token::Type operation, int precedence);
+    void reduce(int precedence);
+    void reduceBinaryExpression();
+    void reduceAssignmentExpression();
+    void reduceFunctionExpression();
+    bool reuseOperand();
+    void recordOperand(int start);
+    void mapSource(const Expression* node, size_t start);
+    void mapSource(const Expression* node, const Expression* first);
+    Identifier* parseDeclaration();
+    Expression* parsePrimaryExpression();
+    Expression* parseFactorialExpression(Expression* expression);
+
+public:
+    // All nodes of the parsed tree are allocated in zone, which must
+    // outlive the tree.
+	Parser(const char *input, size_t length, Zone* zone);
+
+    // Parses tokens scanned in advance, see TokenBuffer. The buffer must
+    // outlive the parser.
+    Parser(const TokenBuffer* tokens, Zone* zone);
+	virtual ~Parser();
+
+    // Continues with a new input, nodes go to the same zone.
+    void reset(const char* input, size_t length);
+
+    // When parsing tokens of a TokenBuffer: takes complete groups, calls
+    // and binary expressions from table instead of parsing them again,
+    // and records those that are parsed, see IncrementalParser. The table
+    // must outlive the parser.
+    void setOperandTable(OperandTable* table)
+    {
+        _operandTable = table;
+    }
+
+    // Records the source range of every node parsed in map, see
+    // Profiler. The map must outlive the parser.
+    void setSourceMap(SourceMap* map)
+    {
+        _sourceMap = map;
+    }
+
+    // Parses the whole input as one expression.
+    ParseResult parse();
+
+    // Parses an expression up to the first token that cannot continue it.
+    // Returns NULL if there are diagnostics.
+    Expression* parseExpression();
+
+    // Parses one expression terminated by ';' or by the end of the input.
+    // Empty statements are skipped. Returns NULL at the end of the input,
+    // and a statement without expression if there are diagnostics.
+    ExpressionStatement* parseStatement();
+
+    // Diagnostics of the last parse.
+    const Diagnostic* diagnostics() const
+    {
+        return _diagnostics.empty() ? NULL : &_diagnostics[0];
+    }
+
+    int diagnosticCount() const
+    {
+        return (int) _diagnostics.size();
+    }
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_PARSER_H_ */
@@ -0,0 +1,284 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "profiler.h"
+#include "binder.h"
+#include "compiler.h"
+#include "interpreter.h"
+#include "parser.h"
+
+namespace Doppio
+{
+
+namespace
+{
+
+// Levels of cost in an annotation, from nothing to the hottest node.
+const char kHeat[] = " .:-=+*#%@";
+const int kHeatLevels = sizeof(kHeat) - 2;
+
+// What the instructions of one node cost.
+struct NodeCost
+{
+    const Expression* node;
+    SourceRange range;
+    uint64_t cycles;
+    uint64_t runs;
+    Instruction::Opcode opcode;
+};
+
+bool isHotter(const NodeCost& x, const NodeCost& y)
+{
+    return x.cycles > y.cycles;
+}
+
+bool isWider(const NodeCost& x, const NodeCost& y)
+{
+    return x.range.end - x.range.start > y.range.end - y.range.start;
+}
+
+} /* anonymous namespace */
+
+SourceMap::SourceMap()
+{
+}
+
+SourceMap::~SourceMap()
+{
+}
+
+Profile::Profile(const Bytecode* bytecode) :
+        _counts(bytecode->instructions().size()),
+        _cycles(bytecode->instructions().size()),
+        _overhead(MeasureOverhead())
+{
+}
+
+Profile::~Profile()
+{
+}
+
+void Profile::clear()
+{
+    std::fill(_counts.begin(), _counts.end(), 0);
+    std::fill(_cycles.begin(), _cycles.end(), 0);
+}
+
+uint64_t Profile::cycles(int instruction) const
+{
+    uint64_t overhead = _counts[instruction] * _overhead;
+    return _cycles[instruction] > overhead ?
+            _cycles[instruction] - overhead : 0;
+}
+
+uint64_t Profile::totalCycles() const
+{
+    uint64_t total = 0;
+    for (int i = 0; i < length(); i++)
+    {
+        total += cycles(i);
+    }
+    return total;
+}
+
+// The least difference of two consecutive reads of the counter.
+uint64_t Profile::MeasureOverhead()
+{
+    uint64_t overhead = UINT64_MAX;
+    for (int i = 0; i < 64; i++)
+    {
+        uint64_t start = ReadCycleCounter();
+        uint64_t end = ReadCycleCounter();
+        overhead = std::min(overhead, end - start);
+    }
+    return overhead;
+}
+
+Profiler::Profiler() :
+        _bytecode(NULL), _interpreter(NULL), _profile(NULL), _error(NULL)
+{
+}
+
+Profiler::~Profiler()
+{
+    release();
+}
+
+void Profiler::release()
+{
+    delete _profile;
+    delete _interpreter;
+    delete _bytecode;
+    _profile = NULL;
+    _interpreter = NULL;
+    _bytecode = NULL;
+    _sourceMap.clear();
+    _sourceNodes.clear();
+    _zone.deleteAll();
+}
+
+bool Profiler::compile(const char* text, size_t length, Scope* scope)
+{
+    release();
+    _text.assign(text, length);
+    _error = NULL;
+
+    Parser parser(_text.data(), _text.size(), &_zone);
+    parser.setSourceMap(&_sourceMap);
+    ParseResult result = parser.parse();
+    if (!result.succeeded())
+    {
+        _error = result.diagnostics[0].message;
+        return false;
+    }
+    Binder binder(scope);
+    if (!binder.bind(result.expression))
+    {
+        _error = binder.error();
+        return false;
+    }
+
+    BytecodeCompiler compiler;
+    compiler.setSourceNodes(&_sourceNodes);
+    _bytecode = compiler.compile(result.expression, scope);
+    if (_bytecode == NULL)
+    {
+        _error = compiler.error();
+        return false;
+    }
+    _interpreter = new Interpreter(_bytecode);
+    _profile = new Profile(_bytecode);
+    return true;
+}
+
+Value Profiler::evaluate(Value* environment)
+{
+    ASSERT(_interpreter != NULL);
+    return _interpreter->profile(environment, _profile);
+}
+
+const SourceRange* Profiler::source(int instruction) const
+{
+    const Expression* node = _sourceNodes[instruction];
+    return node ? _sourceMap.find(node) : NULL;
+}
+
+void Profiler::writeAnnotated(FILE* out, int hotSpots) const
+{
+    if (_profile == NULL)
+    {
+        return;
+    }
+
+    // the cost of each node with a range
+    std::vector<NodeCost> costs;
+    std::unordered_map<const Expression*, size_t> indexes;
+    for (int i = 0; i < _profile->length(); i++)
+    {
+        const SourceRange* range = source(i);
+        if (range == NULL)
+        {
+            continue;
+        }
+        std::pair<std::unordered_map<const Expression*, size_t>::iterator,
+                bool> entry = indexes.insert(
+                std::make_pair(_sourceNodes[i], costs.size()));
+        if (entry.second)
+        {
+            NodeCost cost = { _sourceNodes[i], *range, 0, _profile->count(i),
+                    Instruction::RETURN };
+            costs.push_back(cost);
+        }
+        NodeCost& cost = costs[entry.first->second];
+        cost.cycles += _profile->cycles(i);
+        // the operation itself comes after the conversions of its operands
+        cost.opcode = (Instruction::Opcode) _bytecode->instructions()[i].opcode;
+    }
+
+    uint64_t total = _profile->totalCycles();
+    uint64_t runs = _profile->runs();
+    fprintf(out, "profile: %llu runs, %.1f cycles per run\n",
+            (unsigned long long) runs, runs ? (double) total / runs : 0.0);
+
+    // inner nodes paint over the nodes they are part of
+    uint64_t hottest = 0;
+    for (size_t i = 0; i < costs.size(); i++)
+    {
+        hottest = std::max(hottest, costs[i].cycles);
+    }
+    std::string heat(_text.size(), ' ');
+    std::stable_sort(costs.begin(), costs.end(), isWider);
+    for (size_t i = 0; i < costs.size(); i++)
+    {
+        int level = hottest == 0 ? 0 : (int) ((costs[i].cycles * kHeatLevels
+                + hottest - 1) / hottest);
+        for (size_t c = costs[i].range.start; c < costs[i].range.end; c++)
+        {
+            heat[c] = kHeat[level];
+        }
+    }
+    size_t line = 0;
+    while (line < _text.size())
+    {
+        size_t end = _text.find('\n', line);
+        if (end == std::string::npos)
+        {
+            end = _text.size();
+        }
+        std::string text = _text.substr(line, end - line);
+        std::string marks = heat.substr(line, end - line);
+        for (size_t c = 0; c < text.size(); c++)
+        {
+            // keep the marks under their characters
+            if (text[c] == '\t')
+            {
+                marks[c] = text[c];
+            }
+        }
+        fprintf(out, "  %s\n  %s\n", text.c_str(), marks.c_str());
+        line = end + 1;
+    }
+
+    std::stable_sort(costs.begin(), costs.end(), isHotter);
+    if (!costs.empty() && hotSpots > 0)
+    {
+        fprintf(out, "%7s %10s  %-11s %11s  %s\n", "share", "cycles/run",
+                "operation", "range", "text");
+    }
+    for (int i = 0; i < hotSpots && i < (int) costs.size(); i++)
+    {
+        const NodeCost& cost = costs[i];
+        std::string text = _text.substr(cost.range.start,
+                cost.range.end - cost.range.start);
+        std::replace(text.begin(), text.end(), '\n', ' ');
+        if (text.size() > 40)
+        {
+            text = text.substr(0, 37) + "...";
+        }
+        fprintf(out, "%6.1f%% %10.1f  %-11s %5d..%-5d %s\n",
+                total ? 100.0 * cost.cycles / total : 0.0,
+                cost.runs ? (double) cost.cycles / cost.runs : 0.0,
+                Instruction::Name(cost.opcode), (int) cost.range.start,
+                (int) cost.range.end, text.c_str());
+    }
+}
+
+} /* Doppio namespace */
@@ -0,0 +1,226 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_PROFILER_H_
+#define DOPPIO_PROFILER_H_
+
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ast.h"
+#include "bytecode.h"
+#include "scope.h"
+#include "zone.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define DOPPIO_RDTSC 1
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define DOPPIO_RDTSC 1
+#else
+#include <chrono>
+#endif
+
+namespace Doppio
+{
+
+class Interpreter;
+
+// Reads the time stamp counter where the processor has one, a steady
+// clock in nanoseconds elsewhere. Only differences are meaningful.
+// rdtscp waits for the instructions before it to complete, so that the
+// latency of an operation is not charged to the one after it.
+inline uint64_t ReadCycleCounter()
+{
+#ifdef DOPPIO_RDTSC
+    unsigned int processor;
+    return __rdtscp(&processor);
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Byte offsets of the text of a node in the parser's input, from its
+// first token up to the end of its last one. The range of a
+// parenthesized operand includes the parentheses, that of a folded
+// constant the whole text it was folded from.
+struct SourceRange
+{
+    size_t start;
+    size_t end;
+};
+
+// Source ranges of the nodes of a parse, recorded by a Parser given the
+// map, see Parser::setSourceMap(). Nodes created by later passes have no
+// range, and operands the parser takes from an OperandTable keep the
+// ranges of the parse that recorded them.
+class SourceMap
+{
+public:
+    SourceMap();
+    ~SourceMap();
+
+    void clear()
+    {
+        _ranges.clear();
+    }
+
+    void set(const Expression* node, size_t start, size_t end)
+    {
+        SourceRange& range = _ranges[node];
+        range.start = start;
+        range.end = end;
+    }
+
+    // Returns NULL if the node has no range.
+    const SourceRange* find(const Expression* node) const
+    {
+        std::unordered_map<const Expression*, SourceRange>::const_iterator it =
+                _ranges.find(node);
+        return it == _ranges.end() ? NULL : &it->second;
+    }
+
+private:
+    std::unordered_map<const Expression*, SourceRange> _ranges;
+
+    // Source maps are not copyable.
+    SourceMap(const SourceMap&);
+    SourceMap& operator=(const SourceMap&);
+};
+
+// Execution counts and cycles of the instructions of one Bytecode,
+// collected by Interpreter::profile(). Each instruction is charged the
+// cycles from its dispatch to the dispatch of the next one, which
+// includes the cost of dispatching and of counting; the measured cost of
+// reading the counter itself is taken off again by cycles().
+class Profile
+{
+public:
+    explicit Profile(const Bytecode* bytecode);
+    ~Profile();
+
+    // Drops the counts, for example after warming up.
+    void clear();
+
+    void record(int instruction, uint64_t cycles)
+    {
+        _counts[instruction]++;
+        _cycles[instruction] += cycles;
+    }
+
+    int length() const
+    {
+        return (int) _counts.size();
+    }
+
+    uint64_t count(int instruction) const
+    {
+        return _counts[instruction];
+    }
+
+    uint64_t cycles(int instruction) const;
+    uint64_t totalCycles() const;
+
+    // Times the program was run, the count of its RETURN.
+    uint64_t runs() const
+    {
+        return _counts.empty() ? 0 : _counts.back();
+    }
+
+private:
+    std::vector<uint64_t> _counts;
+    std::vector<uint64_t> _cycles;
+    uint64_t _overhead;
+
+    static uint64_t MeasureOverhead();
+};
+
+// Finds the hot spots of a formula. The profiler parses the formula with
+// a SourceMap, compiles it recording the node of every instruction, see
+// BytecodeCompiler::setSourceNodes(), and runs it in the profiling loop
+// of an Interpreter. writeAnnotated() then charges the cycles of the
+// instructions to the text of their nodes.
+//
+// Profiling is opt-in: Interpreter::evaluate() is compiled from the same
+// loop without any of the counting, and bytecode compiled without source
+// nodes carries nothing extra.
+class Profiler
+{
+public:
+    Profiler();
+    ~Profiler();
+
+    // Parses text, binds it in scope and compiles it, dropping any
+    // earlier formula and its profile. Returns false if the text does not
+    // parse, bind or compile; error() then describes the first problem found.
+    bool compile(const char* text, size_t length, Scope* scope);
+
+    const char* error() const
+    {
+        return _error;
+    }
+
+    // Evaluates the formula as Interpreter::evaluate() does, adding to
+    // the profile.
+    Value evaluate(Value* environment);
+
+    const Bytecode* bytecode() const
+    {
+        return _bytecode;
+    }
+
+    const Profile* profile() const
+    {
+        return _profile;
+    }
+
+    // The range of the node of an instruction, or NULL for the final
+    // RETURN and for nodes without range.
+    const SourceRange* source(int instruction) const;
+
+    // Writes the formula with a line under each line of text that marks
+    // the cost of the innermost node covering each character, from ' '
+    // (nothing) to '@' (the hottest node), followed by the hottest nodes
+    // with their share of all cycles, cycles per run and text.
+    void writeAnnotated(FILE* out, int hotSpots = 5) const;
+
+private:
+    std::string _text;
+    Zone _zone;
+    SourceMap _sourceMap;
+    std::vector<const Expression*> _sourceNodes;
+    Bytecode* _bytecode;
+    Interpreter* _interpreter;
+    Profile* _profile;
+    const char* _error;
+
+    void release();
+
+    // Profilers are not copyable.
+    Profiler(const Profiler&);
+    Profiler& operator=(const Profiler&);
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_PROFILER_H_ */
@@ -0,0 +1,192 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "program.h"
+
+#if !defined(_WIN32)
+#define DOPPIO_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Doppio
+{
+
+#ifdef DOPPIO_MMAP
+
+MappedFile::MappedFile(const char* path) :
+        _data(NULL), _length(0)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return;
+    }
+    struct stat status;
+    if (fstat(fd, &status) == 0 && status.st_size > 0)
+    {
+        void* data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd,
+                0);
+        if (data != MAP_FAILED)
+        {
+            // statements are read once, front to back
+            madvise(data, status.st_size, MADV_SEQUENTIAL);
+            _data = (const char*) data;
+            _length = status.st_size;
+        }
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (_data)
+    {
+        munmap((void*) _data, _length);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const char* path) :
+        _data(NULL), _length(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+}
+
+#endif
+
+ProgramParser::ProgramParser(const char* input, size_t length) :
+        _parser(NULL, 0, &_zone), _stream(NULL), _chunkSize(0),
+        _buffer((char*) input), _capacity(0), _statement(input),
+        _searched(input), _limit(input + length), _bufferOffset(0),
+        _statementOffset(0)
+{
+}
+
+ProgramParser::ProgramParser(FILE* stream, size_t chunkSize) :
+        _parser(NULL, 0, &_zone), _stream(stream), _chunkSize(chunkSize),
+        _buffer(NULL), _capacity(0), _statement(NULL), _searched(NULL),
+        _limit(NULL), _bufferOffset(0), _statementOffset(0)
+{
+    ASSERT(chunkSize > 0);
+}
+
+ProgramParser::~ProgramParser()
+{
+    if (_stream)
+    {
+        free(_buffer);
+    }
+}
+
+ExpressionStatement* ProgramParser::parseStatement()
+{
+    const char* text;
+    size_t length;
+    while (nextStatement(&text, &length))
+    {
+        _zone.deleteAll();
+        _parser.reset(text, length);
+        ExpressionStatement* statement = _parser.parseStatement();
+        if (statement)
+        {
+            return statement;
+        }
+    }
+    return NULL;
+}
+
+// Cuts the text of the next statement out of the input, without its ';'.
+// Returns false at the end of the input.
+bool ProgramParser::nextStatement(const char** text, size_t* length)
+{
+    while (true)
+    {
+        const char* semicolon = NULL;
+        if (_searched < _limit)
+        {
+            semicolon = (const char*) memchr(_searched, ';',
+                    _limit - _searched);
+        }
+        if (semicolon == NULL)
+        {
+            _searched = _limit;
+            if (fill())
+            {
+                continue;
+            }
+            if (_statement == _limit)
+            {
+                return false;
+            }
+            // the last statement needs no ';'
+            semicolon = _limit;
+        }
+        *text = _statement;
+        *length = semicolon - _statement;
+        _statementOffset = _bufferOffset + (_statement - _buffer);
+        _statement = _searched = semicolon < _limit ? semicolon + 1 : _limit;
+        return true;
+    }
+}
+
+// Reads the next chunk of a stream behind the pending text of the current
+// statement. Returns false if nothing more could be read.
+bool ProgramParser::fill()
+{
+    if (_stream == NULL)
+    {
+        return false;
+    }
+    size_t pending = _limit - _statement;
+    size_t searched = _searched - _statement;
+    if (_buffer && _statement != _buffer)
+    {
+        memmove(_buffer, _statement, pending);
+        _bufferOffset += _statement - _buffer;
+    }
+    if (_capacity - pending < _chunkSize)
+    {
+        size_t capacity = _capacity == 0 ? _chunkSize : 2 * _capacity;
+        while (capacity - pending < _chunkSize)
+        {
+            capacity *= 2;
+        }
+        char* buffer = (char*) realloc(_buffer, capacity);
+        if (buffer == NULL)
+        {
+            return false;
+        }
+        _buffer = buffer;
+        _capacity = capacity;
+    }
+    size_t count = fread(_buffer + pending, 1, _chunkSize, _stream);
+    _statement = _buffer;
+    _searched = _buffer + searched;
+    _limit = _buffer + pending + count;
+    return count > 0;
+}
+
+} /* Doppio namespace */
@@ -0,0 +1,149 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_PROGRAM_H_
+#define DOPPIO_PROGRAM_H_
+
+#include <cstdio>
+#include "parser.h"
+
+namespace Doppio
+{
+
+// A file mapped read-only into memory. Mapping is not available on every
+// platform, isOpen() tells whether it succeeded.
+class MappedFile
+{
+public:
+    explicit MappedFile(const char* path);
+    ~MappedFile();
+
+    bool isOpen() const
+    {
+        return _data != NULL;
+    }
+
+    const char* data() const
+    {
+        return _data;
+    }
+
+    size_t length() const
+    {
+        return _length;
+    }
+
+private:
+    const char* _data;
+    size_t _length;
+
+    // Mappings are not copyable.
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+// Parses a program of ';'-separated statements one statement at a time,
+// from memory (e.g. a MappedFile) or from a stream read in chunks.
+//
+// Each statement is cut out at its ';' before it is parsed, so a token
+// split between two chunks is always scanned whole. Only the statement
+// being parsed is kept: the stream buffer grows to the largest statement
+// plus a chunk, and its tree lives in a zone that is emptied before the
+// next statement is parsed.
+class ProgramParser
+{
+public:
+    static const size_t kDefaultChunkSize = 64 * 1024;
+
+    // The input must outlive the parser.
+    ProgramParser(const char* input, size_t length);
+
+    // Reads the stream with fread until its end or a read error, which
+    // the caller can tell apart with ferror().
+    explicit ProgramParser(FILE* stream, size_t chunkSize = kDefaultChunkSize);
+    ~ProgramParser();
+
+    // Returns the next statement or NULL at the end of the input. The
+    // statement is valid until the next call. A statement with syntax
+    // errors has no expression, parser() then holds the diagnostics.
+    ExpressionStatement* parseStatement();
+
+    // Calls handler(statement) for every remaining statement, in order,
+    // and returns their number.
+    template<typename Handler>
+    size_t parseProgram(Handler& handler)
+    {
+        size_t count = 0;
+        while (ExpressionStatement* statement = parseStatement())
+        {
+            handler(statement);
+            count++;
+        }
+        return count;
+    }
+
+    // Offset in the input of the text of the last statement. Token
+    // offsets within a statement are relative to it.
+    size_t statementOffset() const
+    {
+        return _statementOffset;
+    }
+
+    const Parser* parser() const
+    {
+        return &_parser;
+    }
+
+    // Bytes held for stream input.
+    size_t bufferCapacity() const
+    {
+        return _capacity;
+    }
+
+private:
+    Zone _zone;
+    Parser _parser;
+
+    FILE* _stream;
+    size_t _chunkSize;
+
+    // For stream input a malloc'd buffer of _capacity bytes, otherwise
+    // the input itself. It holds the unparsed text up to _limit, starting
+    // at _statement; no ';' occurs in [_statement, _searched).
+    char* _buffer;
+    size_t _capacity;
+    const char* _statement;
+    const char* _searched;
+    const char* _limit;
+
+    // Offset in the input of _buffer[0].
+    size_t _bufferOffset;
+    size_t _statementOffset;
+
+    bool nextStatement(const char** text, size_t* length);
+    bool fill();
+
+    // Parsers are not copyable.
+    ProgramParser(const ProgramParser&);
+    ProgramParser& operator=(const ProgramParser&);
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_PROGRAM_H_ */
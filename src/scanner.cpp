@@ -1,237 +1,671 @@
-/*
- * Licensed to the Apache Software Foundation (ASF) under one
- * or more contributor license agreements.  See the NOTICE file
- * distributed with this work for additional information
- * regarding copyright ownership.  The ASF licenses this file
- * to you under the Apache License, Version 2.0 (the
- * "License"); you may not use this file except in compliance
- * with the License.  You may obtain a copy of the License at
- *
- * http://www.apache.org/licenses/LICENSE-2.0
- *
- * Unless required by applicable law or agreed to in writing,
- * software distributed under the License is distributed on an
- * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
- * KIND, either express or implied.  See the License for the
- * specific language governing permissions and limitations
- * under the License.
- */
-
-#include "scanner.h"
-
-namespace Doppio
-{
-
-Scanner::Scanner(const char* input, size_t length)
-{
-    _beg = input;
-    _cur = input;
-    _end = input + length;
-    _c0 = *input;
-    scan();
-}
-
-Scanner::~Scanner()
-{
-}
-
-Token::Type Scanner::next()
-{
-    _current = _next;
-    scan();
-    return _current.type;
-}
-
-Token::Type Scanner::peek() const
-{
-    return _next.type;
-}
-
-Token::Type Scanner::current() const
-{
-    return _current.type;
-}
-
-Token Scanner::currentToken() const
-{
-    return _current;
-}
-
-void Scanner::scan()
-{
-    while (isspace(_c0) && _cur < _end)
-    {
-        advance();
-    }
-
-    Token::Type tokenType;
-    _next.start = _cur - _beg;
-    if (_cur >= _end)
-    {
-        tokenType = select(Token::EOS);
-    }
-    else
-    {
-        switch (_c0)
-        {
-        case '=':
-            tokenType = select(Token::ASSIGN);
-            break;
-
-        case '!':
-            tokenType = select(Token::FACTORIAL);
-            break;
-
-        case '+':
-            tokenType = select(Token::ADD);
-            break;
-
-        case '-':
-            tokenType = select(Token::SUB);
-            break;
-
-        case '*':
-            tokenType = select(Token::MUL);
-            break;
-
-        case '%':
-            tokenType = select(Token::MOD);
-            break;
-
-        case '/':
-            tokenType = select(Token::DIV);
-            break;
-
-        case '^':
-            tokenType = select(Token::POW);
-            break;
-
-        case ';':
-            tokenType = select(Token::SEMICOLON);
-            break;
-
-        case ',':
-            tokenType = select(Token::COMMA);
-            break;
-
-        case '(':
-            tokenType = select(Token::LPAREN);
-            break;
-
-        case ')':
-            tokenType = select(Token::RPAREN);
-            break;
-
-        default:
-            if (isalpha(_c0) || _c0 == '_')
-            {
-                tokenType = scanIdentifierOrKeyword();
-            }
-            else if (isdigit(_c0) || _c0 == '.')
-            {
-                tokenType = scanNumber();
-            }
-            else
-            {
-                tokenType = select(Token::ILLEGAL);
-            }
-            break;
-        }
-    }
-    _next.end = _cur - _beg;
-    _next.type = tokenType;
-}
-
-Token::Type Scanner::scanIdentifierOrKeyword()
-{
-    ASSERT(_cur < _end);
-    const char *input = _cur;
-    while (isalpha(_c0) || isdigit(_c0) || _c0 == '_')
-    {
-        advance();
-    }
-
-    Token::Type tokenType = Token::IDENTIFIER;
-    size_t inputLength = _cur - input;
-#define T(a, b, c)
-#define K(name, keyword, precedence)                                        \
-    {                                                                       \
-        size_t keywordLength = sizeof(keyword) - 1;                         \
-        if (inputLength == keywordLength && input[1] == keyword[1]          \
-                && (keywordLength <= 2 || input[2] == keyword[2])           \
-                && (keywordLength <= 3 || input[3] == keyword[3])           \
-                && (keywordLength <= 4 || input[4] == keyword[4])           \
-                && (keywordLength <= 5 || input[5] == keyword[5])           \
-                && (keywordLength <= 6 || input[6] == keyword[6])           \
-                && (keywordLength <= 7 || input[7] == keyword[7])           \
-                && (keywordLength <= 8 || input[8] == keyword[8])           \
-                && (keywordLength <= 9 || input[9] == keyword[9]))          \
-        {                                                                   \
-            tokenType = Token::name;                                        \
-        }                                                                   \
-    }
-    TOKEN_LIST(T, K)
-#undef T
-#undef K
-
-    return tokenType;
-}
-
-Token::Type Scanner::scanNumber()
-{
-    Token::Type tokenType = Token::NUMBER_INTEGER;
-
-    // read digits
-    while (isdigit(_c0) && _cur < _end)
-    {
-        advance();
-    }
-
-    // read fraction
-    if (_cur < _end && _c0 == '.')
-    {
-        tokenType = Token::NUMBER_FLOAT;
-        advance();
-        while (isdigit(_c0) && _cur < _end)
-        {
-            advance();
-        }
-    }
-
-    // read exponent, if any
-    if (_c0 == 'e' || _c0 == 'E')
-    {
-        advance();
-        if (_c0 == '+' || _c0 == '-')
-        {
-            advance();
-        }
-        if (isdigit(_c0))
-        {
-            while (isdigit(_c0) && _cur < _end)
-            {
-                advance();
-            }
-        }
-        else
-        {
-            // we must have at least one decimal digit after 'e'/'E'
-            tokenType = Token::ILLEGAL;
-        }
-    }
-
-    return tokenType;
-}
-
-Token::Type Scanner::select(Token::Type type)
-{
-    advance();
-    return type;
-}
-
-void Scanner::advance()
-{
-    _c0 = *(++_cur);
-}
-
-} /* Doppio namespace */
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <climits>
+#include <clocale>
+#include <cstdlib>
+#include <string>
+#if defined(__APPLE__)
+#include <xlocale.h>
+#endif
+#include "scanner.h"
+#include "stats.h"
+#include "tokens.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace Doppio
+{
+
+namespace
+{
+
+enum CharacterClass
+{
+    kWhitespace = 1 << 0,
+    kLetter = 1 << 1,
+    kDigit = 1 << 2,
+    kIdentifierPart = kLetter | kDigit
+};
+
+// Character classes of the C locale. Letters include '_'. Bytes above
+// 0x7f belong to no class and are left zero.
+#define W kWhitespace
+#define L kLetter
+#define D kDigit
+const uint8_t kCharacterClass[256] =
+{
+    0, 0, 0, 0, 0, 0, 0, 0, 0, W, W, W, W, W, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    W, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    D, D, D, D, D, D, D, D, D, D, 0, 0, 0, 0, 0, 0,
+    0, L, L, L, L, L, L, L, L, L, L, L, L, L, L, L,
+    L, L, L, L, L, L, L, L, L, L, L, 0, 0, 0, 0, L,
+    0, L, L, L, L, L, L, L, L, L, L, L, L, L, L, L,
+    L, L, L, L, L, L, L, L, L, L, L, 0, 0, 0, 0, 0,
+};
+#undef W
+#undef L
+#undef D
+
+inline bool isClass(char c, int characterClass)
+{
+    return (kCharacterClass[(uint8_t) c] & characterClass) != 0;
+}
+
+#if defined(__SSE2__)
+// Lanes of v between lo and hi inclusive are set to 0xff.
+inline __m128i inRange(__m128i v, char lo, char hi)
+{
+    __m128i offset = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(
+            _mm_min_epu8(offset, _mm_set1_epi8((char) (hi - lo))), offset);
+}
+
+template<int characterClass>
+inline __m128i classify(__m128i v)
+{
+    __m128i result = _mm_setzero_si128();
+    if (characterClass & kWhitespace)
+    {
+        result = _mm_or_si128(result,
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                        inRange(v, '\t', '\r')));
+    }
+    if (characterClass & kLetter)
+    {
+        // 'A'-'Z' | 0x20 is 'a'-'z' and no other byte maps there
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        result = _mm_or_si128(result,
+                _mm_or_si128(inRange(lower, 'a', 'z'),
+                        _mm_cmpeq_epi8(v, _mm_set1_epi8('_'))));
+    }
+    if (characterClass & kDigit)
+    {
+        result = _mm_or_si128(result, inRange(v, '0', '9'));
+    }
+    return result;
+}
+#endif
+
+#if defined(__AVX2__)
+inline __m256i inRange(__m256i v, char lo, char hi)
+{
+    __m256i offset = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(
+            _mm256_min_epu8(offset, _mm256_set1_epi8((char) (hi - lo))),
+            offset);
+}
+
+template<int characterClass>
+inline __m256i classify(__m256i v)
+{
+    __m256i result = _mm256_setzero_si256();
+    if (characterClass & kWhitespace)
+    {
+        result = _mm256_or_si256(result,
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                        inRange(v, '\t', '\r')));
+    }
+    if (characterClass & kLetter)
+    {
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        result = _mm256_or_si256(result,
+                _mm256_or_si256(inRange(lower, 'a', 'z'),
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'))));
+    }
+    if (characterClass & kDigit)
+    {
+        result = _mm256_or_si256(result, inRange(v, '0', '9'));
+    }
+    return result;
+}
+#endif
+
+// Returns the first position in [position, end) whose character is not of
+// the given class, or end. Vector loads are made only while a whole
+// vector fits before end, the rest is classified from the table.
+template<int characterClass>
+const char* skip(const char* position, const char* end)
+{
+    // most runs are a single space or a short name
+    if (position == end || !isClass(*position, characterClass))
+    {
+        return position;
+    }
+#if defined(__AVX2__)
+    while (end - position >= 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*) position);
+        uint32_t mask = ~(uint32_t) _mm256_movemask_epi8(
+                classify<characterClass>(v));
+        if (mask)
+        {
+            return position + __builtin_ctz(mask);
+        }
+        position += 32;
+    }
+#endif
+#if defined(__SSE2__)
+    while (end - position >= 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*) position);
+        uint32_t mask = ~(uint32_t) _mm_movemask_epi8(
+                classify<characterClass>(v)) & 0xffff;
+        if (mask)
+        {
+            return position + __builtin_ctz(mask);
+        }
+        position += 16;
+    }
+#endif
+    while (position < end && isClass(*position, characterClass))
+    {
+        position++;
+    }
+    return position;
+}
+
+// Powers of ten that are exact doubles.
+const double kPowersOfTen[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+    1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+const int kMaximumExactPowerOfTen = 22;
+const uint64_t kMaximumExactMantissa = (uint64_t) 1 << 53;
+
+// A numeric literal as mantissa * 10^exponent, accumulated while the
+// scanner walks the digits. The first 19 significant digits are kept
+// exactly, later ones only mark the mantissa as truncated.
+struct Decimal
+{
+    static const int kMaximumDigits = 19;
+    static const int kMaximumExponent = 100000;
+
+    uint64_t mantissa;
+    int digits;
+    int exponent;
+    bool truncated;
+
+    Decimal() :
+            mantissa(0), digits(0), exponent(0), truncated(false)
+    {
+    }
+
+    void addDigits(const char* position, const char* end, bool fraction)
+    {
+        for (; position < end; position++)
+        {
+            int digit = *position - '0';
+            if (digits < kMaximumDigits)
+            {
+                mantissa = mantissa * 10 + digit;
+                // leading zeros are not significant
+                if (mantissa != 0)
+                {
+                    digits++;
+                }
+                if (fraction)
+                {
+                    exponent--;
+                }
+            }
+            else
+            {
+                truncated = truncated || digit != 0;
+                if (!fraction)
+                {
+                    exponent++;
+                }
+            }
+        }
+    }
+
+    void addExponent(const char* position, const char* end, bool negative)
+    {
+        int value = 0;
+        for (; position < end && value < kMaximumExponent; position++)
+        {
+            value = value * 10 + (*position - '0');
+        }
+        exponent += negative ? -value : value;
+    }
+
+    bool toInteger(long* result) const
+    {
+        if (exponent != 0 || truncated || mantissa > (uint64_t) LONG_MAX)
+        {
+            return false;
+        }
+        *result = (long) mantissa;
+        return true;
+    }
+
+    // Returns the correctly rounded double of the literal text between
+    // start and end.
+    double toDouble(const char* start, const char* end) const
+    {
+        // Clinger's fast path: an exact mantissa and an exact power of ten
+        // round once, in the final multiplication or division.
+        if (!truncated && mantissa <= kMaximumExactMantissa)
+        {
+            if (mantissa == 0 || exponent == 0)
+            {
+                return (double) mantissa;
+            }
+            if (exponent < 0 && exponent >= -kMaximumExactPowerOfTen)
+            {
+                return (double) mantissa / kPowersOfTen[-exponent];
+            }
+            // 123e25 is 123000e22, as long as the mantissa stays exact
+            uint64_t scaled = mantissa;
+            int power = exponent;
+            while (power > kMaximumExactPowerOfTen
+                    && scaled * 10 <= kMaximumExactMantissa)
+            {
+                scaled *= 10;
+                power--;
+            }
+            if (power > 0 && power <= kMaximumExactPowerOfTen)
+            {
+                return (double) scaled * kPowersOfTen[power];
+            }
+        }
+        return slowToDouble(start, end);
+    }
+
+    // strtod needs a terminated string. It is given the C locale, made
+    // once, so that the decimal point is '.' whatever the locale of the
+    // process and no thread reads the global locale.
+    static double slowToDouble(const char* start, const char* end)
+    {
+        std::string text(start, end);
+#if defined(_MSC_VER)
+        static const _locale_t locale = _create_locale(LC_NUMERIC, "C");
+        return _strtod_l(text.c_str(), NULL, locale);
+#else
+        static const locale_t locale = newlocale(LC_NUMERIC_MASK, "C",
+                (locale_t) 0);
+        return strtod_l(text.c_str(), NULL, locale);
+#endif
+    }
+};
+
+// Keywords are recognized with a perfect hash of the length and the first,
+// middle and last characters. The hash seed and the table are computed by
+// the compiler from TOKEN_LIST, so adding a keyword needs no other change;
+// compilation fails if no seed separates all keywords.
+struct Keyword
+{
+    const char* string;
+    size_t length;
+    Token::Type type;
+};
+
+#define T(name, string, precedence)
+#define K(name, string, precedence) { string, sizeof(string) - 1, Token::name },
+constexpr Keyword kKeywords[] =
+{ TOKEN_LIST(T, K) };
+#undef T
+#undef K
+
+constexpr int kKeywordCount = sizeof(kKeywords) / sizeof(kKeywords[0]);
+constexpr int kKeywordTableBits = 8;
+constexpr unsigned kKeywordTableSize = 1 << kKeywordTableBits;
+constexpr unsigned kMaximumKeywordSeed = 1 << 16;
+
+static_assert(kKeywordCount < 256, "keyword indices must fit in a byte");
+static_assert(kKeywordTableSize == 256, "kKeywordTable is initialized for 256");
+
+constexpr unsigned keywordHash(unsigned seed, size_t length, char first,
+        char middle, char last)
+{
+    return ((((uint8_t) first * 31u + (uint8_t) middle) * 31u + (uint8_t) last)
+            * 31u + (unsigned) length) * (0x9e3779b1u + 2 * seed)
+            >> (32 - kKeywordTableBits);
+}
+
+constexpr unsigned keywordHash(unsigned seed, int i)
+{
+    return keywordHash(seed, kKeywords[i].length, kKeywords[i].string[0],
+            kKeywords[i].string[kKeywords[i].length / 2],
+            kKeywords[i].string[kKeywords[i].length - 1]);
+}
+
+// True if keyword i has the same hash as one of the keywords j..i-1.
+constexpr bool collides(unsigned seed, int i, int j)
+{
+    return j < i
+            && (keywordHash(seed, i) == keywordHash(seed, j)
+                    || collides(seed, i, j + 1));
+}
+
+constexpr bool isPerfect(unsigned seed, int i)
+{
+    return i == kKeywordCount
+            || (!collides(seed, i, 0) && isPerfect(seed, i + 1));
+}
+
+// Returns the smallest perfect seed in [low, high], or 0. The range is
+// bisected to keep the recursion depth logarithmic.
+constexpr unsigned findSeed(unsigned low, unsigned high);
+
+constexpr unsigned findSeedAbove(unsigned found, unsigned middle,
+        unsigned high)
+{
+    return found ? found : findSeed(middle + 1, high);
+}
+
+constexpr unsigned findSeed(unsigned low, unsigned high)
+{
+    return low == high ? (isPerfect(low, 0) ? low : 0) :
+            findSeedAbove(findSeed(low, (low + high) / 2), (low + high) / 2,
+                    high);
+}
+
+constexpr unsigned kKeywordSeed = findSeed(1, kMaximumKeywordSeed);
+
+static_assert(kKeywordSeed != 0, "no perfect keyword hash, two keywords may "
+        "share their length and first, middle and last characters");
+
+// One plus the index of the keyword hashed to slot, or 0.
+constexpr uint8_t keywordSlot(unsigned slot, int i)
+{
+    return i == kKeywordCount ? 0 :
+            keywordHash(kKeywordSeed, i) == slot ? i + 1 :
+                    keywordSlot(slot, i + 1);
+}
+
+#define S(slot) keywordSlot(slot, 0)
+#define S4(slot) S(slot), S(slot + 1), S(slot + 2), S(slot + 3)
+#define S16(slot) S4(slot), S4(slot + 4), S4(slot + 8), S4(slot + 12)
+#define S64(slot) S16(slot), S16(slot + 16), S16(slot + 32), S16(slot + 48)
+constexpr uint8_t kKeywordTable[kKeywordTableSize] =
+{ S64(0), S64(64), S64(128), S64(192) };
+#undef S
+#undef S4
+#undef S16
+#undef S64
+
+// Returns the only keyword that input may be, or NULL.
+inline const Keyword* lookupKeyword(const char* input, size_t length)
+{
+    uint8_t index = kKeywordTable[keywordHash(kKeywordSeed, length, input[0],
+            input[length / 2], input[length - 1])];
+    return index ? &kKeywords[index - 1] : NULL;
+}
+
+} /* anonymous namespace */
+
+Scanner::Scanner(const char* input, size_t length) :
+        _tokens(NULL), _position(0)
+{
+    reset(input, length);
+}
+
+Scanner::Scanner(const TokenBuffer* tokens) :
+        _tokens(tokens), _position(0)
+{
+    _beg = NULL;
+    _end = NULL;
+    seek(NULL);
+    scan();
+}
+
+Scanner::~Scanner()
+{
+}
+
+void Scanner::reset(const char* input, size_t length)
+{
+    _tokens = NULL;
+    _position = 0;
+    _beg = input;
+    _end = input + length;
+    seek(input);
+    scan();
+}
+
+Token::Type Scanner::next()
+{
+    _current = _next;
+    scan();
+    return _current.type;
+}
+
+Token::Type Scanner::peek() const
+{
+    return _next.type;
+}
+
+Token::Type Scanner::current() const
+{
+    return _current.type;
+}
+
+const Token& Scanner::currentToken() const
+{
+    return _current;
+}
+
+const Token& Scanner::peekToken() const
+{
+    return _next;
+}
+
+int Scanner::tokenIndex() const
+{
+    ASSERT(_tokens != NULL);
+    // scan() stays at the final EOS instead of moving past it
+    return _next.type == Token::EOS ? _position : _position - 1;
+}
+
+void Scanner::seekToken(int index)
+{
+    ASSERT(_tokens != NULL && index > 0 && index < _tokens->length());
+    _current = _tokens->at(index - 1);
+    _position = index;
+    scan();
+}
+
+void Scanner::scan()
+{
+    if (_tokens)
+    {
+        _next = _tokens->at(_position);
+        if (_next.type != Token::EOS)
+        {
+            _position++;
+        }
+        return;
+    }
+
+    seek(skip<kWhitespace>(_cur, _end));
+
+    Token::Type tokenType;
+    _next.start = _cur - _beg;
+    if (_cur >= _end)
+    {
+        tokenType = Token::EOS;
+    }
+    else
+    {
+        switch (_c0)
+        {
+        case '=':
+            tokenType = select(Token::ASSIGN);
+            break;
+
+        case '!':
+            tokenType = select(Token::FACTORIAL);
+            break;
+
+        case '+':
+            tokenType = select(Token::ADD);
+            break;
+
+        case '-':
+            tokenType = select(Token::SUB);
+            break;
+
+        case '*':
+            tokenType = select(Token::MUL);
+            break;
+
+        case '%':
+            tokenType = select(Token::MOD);
+            break;
+
+        case '/':
+            tokenType = select(Token::DIV);
+            break;
+
+        case '^':
+            tokenType = select(Token::POW);
+            break;
+
+        case ';':
+            tokenType = select(Token::SEMICOLON);
+            break;
+
+        case ',':
+            tokenType = select(Token::COMMA);
+            break;
+
+        case '(':
+            tokenType = select(Token::LPAREN);
+            break;
+
+        case ')':
+            tokenType = select(Token::RPAREN);
+            break;
+
+        default:
+            if (isClass(_c0, kLetter))
+            {
+                tokenType = scanIdentifierOrKeyword();
+            }
+            else if (isClass(_c0, kDigit) || _c0 == '.')
+            {
+                tokenType = scanNumber();
+            }
+            else
+            {
+                tokenType = select(Token::ILLEGAL);
+            }
+            break;
+        }
+    }
+    _next.end = _cur - _beg;
+    _next.type = tokenType;
+    Stats::CountToken();
+}
+
+Token::Type Scanner::scanIdentifierOrKeyword()
+{
+    ASSERT(_cur < _end);
+    const char *input = _cur;
+    seek(skip<kIdentifierPart>(_cur + 1, _end));
+
+    size_t length = _cur - input;
+    const Keyword* keyword = lookupKeyword(input, length);
+    if (keyword && keyword->length == length
+            && memcmp(keyword->string, input, length) == 0)
+    {
+        return keyword->type;
+    }
+    _next.symbol = SymbolTable::Current()->intern(input, length);
+    return _next.symbol != SymbolTable::kNoSymbol ?
+            Token::IDENTIFIER : Token::ILLEGAL;
+}
+
+Token::Type Scanner::scanNumber()
+{
+    const char* start = _cur;
+    Decimal decimal;
+    Token::Type tokenType = Token::NUMBER_INTEGER;
+
+    // read digits
+    const char* digits = _cur;
+    seek(skip<kDigit>(_cur, _end));
+    decimal.addDigits(digits, _cur, false);
+
+    // read fraction
+    if (_c0 == '.')
+    {
+        tokenType = Token::NUMBER_FLOAT;
+        digits = _cur + 1;
+        seek(skip<kDigit>(digits, _end));
+        decimal.addDigits(digits, _cur, true);
+    }
+
+    // read exponent, if any
+    if (_c0 == 'e' || _c0 == 'E')
+    {
+        tokenType = Token::NUMBER_FLOAT;
+        advance();
+        bool negative = _c0 == '-';
+        if (_c0 == '+' || _c0 == '-')
+        {
+            advance();
+        }
+        if (isClass(_c0, kDigit))
+        {
+            digits = _cur;
+            seek(skip<kDigit>(_cur, _end));
+            decimal.addExponent(digits, _cur, negative);
+        }
+        else
+        {
+            // we must have at least one decimal digit after 'e'/'E'
+            return Token::ILLEGAL;
+        }
+    }
+
+    // integers that do not fit in a long become reals
+    if (tokenType == Token::NUMBER_INTEGER && decimal.toInteger(&_next.integer))
+    {
+        return Token::NUMBER_INTEGER;
+    }
+    _next.real = decimal.toDouble(start, _cur);
+    return Token::NUMBER_FLOAT;
+}
+
+Token::Type Scanner::select(Token::Type type)
+{
+    advance();
+    return type;
+}
+
+void Scanner::advance()
+{
+    seek(_cur + 1);
+}
+
+void Scanner::seek(const char* position)
+{
+    ASSERT(position <= _end);
+    _cur = position;
+    _c0 = _cur < _end ? *_cur : '\0';
+}
+
+} /* Doppio namespace */
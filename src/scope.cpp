@@ -0,0 +1,87 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "scope.h"
+
+namespace Doppio
+{
+
+Scope::Scope()
+{
+}
+
+Scope::~Scope()
+{
+}
+
+int Scope::declare(Symbol symbol)
+{
+    std::unordered_map<Symbol, int>::const_iterator it = _slots.find(symbol);
+    if (it != _slots.end())
+    {
+        return it->second;
+    }
+    int slot = (int) _symbols.size();
+    _slots[symbol] = slot;
+    _symbols.push_back(symbol);
+    _types.push_back(UNKNOWN_TYPE);
+    _constants.push_back(false);
+    return slot;
+}
+
+int Scope::declare(const char* name, size_t length)
+{
+    Symbol symbol = SymbolTable::Current()->intern(name, length);
+    return symbol != SymbolTable::kNoSymbol ? declare(symbol) : -1;
+}
+
+int Scope::declare(Symbol symbol, StaticType type, bool constant)
+{
+    int slot = lookup(symbol);
+    if (slot < 0)
+    {
+        slot = declare(symbol);
+        _types[slot] = type;
+        _constants[slot] = constant;
+        return slot;
+    }
+    return _types[slot] == type && _constants[slot] == constant ? slot : -1;
+}
+
+int Scope::declare(const char* name, size_t length, StaticType type,
+        bool constant)
+{
+    Symbol symbol = SymbolTable::Current()->intern(name, length);
+    return symbol != SymbolTable::kNoSymbol ?
+            declare(symbol, type, constant) : -1;
+}
+
+int Scope::lookup(Symbol symbol) const
+{
+    std::unordered_map<Symbol, int>::const_iterator it = _slots.find(symbol);
+    return it != _slots.end() ? it->second : -1;
+}
+
+int Scope::lookup(const char* name, size_t length) const
+{
+    Symbol symbol = SymbolTable::Current()->find(name, length);
+    return symbol != SymbolTable::kNoSymbol ? lookup(symbol) : -1;
+}
+
+} /* Doppio namespace */
@@ -0,0 +1,92 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_SCOPE_H_
+#define DOPPIO_SCOPE_H_
+
+#include <unordered_map>
+#include <vector>
+#include "symbols.h"
+#include "value.h"
+
+namespace Doppio
+{
+
+// Maps variable names to slots of a flat environment. Slots are handed out
+// densely in declaration order, so an environment for a scope is simply an
+// array of variableCount() values.
+class Scope
+{
+public:
+    Scope();
+    ~Scope();
+
+    // Returns the slot of the variable, declaring it first if necessary.
+    // Symbols are those of SymbolTable::Current(); declaring by name
+    // returns -1 if that table is full.
+    int declare(Symbol symbol);
+    int declare(const char* name, size_t length);
+
+    // Declares a variable of the given type, which a constant keeps for
+    // good. Declaring a variable again is allowed only with the same type
+    // and constness; -1 is returned otherwise.
+    int declare(Symbol symbol, StaticType type, bool constant = false);
+    int declare(const char* name, size_t length, StaticType type,
+            bool constant = false);
+
+    // Returns the slot of the variable or -1 if it is not declared.
+    int lookup(Symbol symbol) const;
+    int lookup(const char* name, size_t length) const;
+
+    int variableCount() const
+    {
+        return (int) _symbols.size();
+    }
+
+    Symbol variableSymbol(int slot) const
+    {
+        return _symbols[slot];
+    }
+
+    const char* variableName(int slot) const
+    {
+        return SymbolTable::Current()->name(_symbols[slot]);
+    }
+
+    // UNKNOWN_TYPE for variables declared without a type.
+    StaticType variableType(int slot) const
+    {
+        return _types[slot];
+    }
+
+    bool isConstant(int slot) const
+    {
+        return _constants[slot];
+    }
+
+private:
+    std::unordered_map<Symbol, int> _slots;
+    std::vector<Symbol> _symbols;
+    std::vector<StaticType> _types;
+    std::vector<bool> _constants;
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_SCOPE_H_ */
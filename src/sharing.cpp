@@ -0,0 +1,300 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <cstring>
+#include "sharing.h"
+
+namespace Doppio
+{
+
+namespace
+{
+
+// Collects the symbols of all variables assigned in a tree.
+class AssignmentCollector: public AstVisitor<AssignmentCollector>
+{
+public:
+    explicit AssignmentCollector(std::set<Symbol>* symbols) :
+            _symbols(symbols)
+    {
+    }
+
+    void visitAssignmentExpression(AssignmentExpression* node)
+    {
+        Identifier* target = node->target()->asIdentifier();
+        if (target)
+        {
+            _symbols->insert(target->symbol());
+        }
+        visit(node->value());
+    }
+
+    void visitUnaryOperationExpression(UnaryOperationExpression* node)
+    {
+        visit(node->expression());
+    }
+
+    void visitBinaryOperationExpression(
+            BinaryOperationExpression* node)
+    {
+        visit(node->left());
+        visit(node->right());
+    }
+
+    void visitFunctionExpression(FunctionExpression* node)
+    {
+        for (int i = 0; i < node->arguments().length(); i++)
+        {
+            visit(node->arguments()[i]);
+        }
+    }
+
+    void visitIdentifier(Identifier*)
+    {
+    }
+
+    void visitNumber(Number*)
+    {
+    }
+
+private:
+    std::set<Symbol>* _symbols;
+};
+
+void appendBytes(std::string* key, const void* bytes, size_t length)
+{
+    key->append((const char*) bytes, length);
+}
+
+void appendNode(std::string* key, const Expression* node)
+{
+    appendBytes(key, &node, sizeof(node));
+}
+
+} /* anonymous namespace */
+
+SubexpressionSharing::SubexpressionSharing(Zone* zone) :
+        _zone(zone), _result(NULL), _pure(true), _sharedCount(0)
+{
+}
+
+SubexpressionSharing::~SubexpressionSharing()
+{
+}
+
+Expression* SubexpressionSharing::share(Expression* expression)
+{
+    _assigned.clear();
+    _nodes.clear();
+    _sharedCount = 0;
+    AssignmentCollector collector(&_assigned);
+    collector.visit(expression);
+
+    bool pure;
+    return copy(expression, &pure);
+}
+
+Expression* SubexpressionSharing::copy(Expression* node, bool* pure)
+{
+    visit(node);
+    *pure = _pure;
+    return _result;
+}
+
+Expression* SubexpressionSharing::find(const std::string& key)
+{
+    std::unordered_map<std::string, Expression*>::const_iterator it =
+            _nodes.find(key);
+    if (it == _nodes.end())
+    {
+        return NULL;
+    }
+    _sharedCount++;
+    return it->second;
+}
+
+Identifier* SubexpressionSharing::copyIdentifier(Identifier* node)
+{
+    Identifier* result = new (_zone) Identifier(node->symbol(),
+            node->declaredType());
+    result->bind(node->slot());
+    result->setStaticType(node->staticType());
+    return result;
+}
+
+void SubexpressionSharing::visitAssignmentExpression(AssignmentExpression* node)
+{
+    bool pure;
+    Expression* value = copy(node->value(), &pure);
+    Identifier* target = copyIdentifier(node->target()->asIdentifier());
+    _result = new (_zone) AssignmentExpression(node->operation(), target,
+            value);
+    _pure = false;
+}
+
+void SubexpressionSharing::visitUnaryOperationExpression(
+        UnaryOperationExpression* node)
+{
+    bool pure;
+    Expression* expression = copy(node->expression(), &pure);
+    std::string key = "U";
+    key += Token::Name(node->operation());
+    appendNode(&key, expression);
+    _result = pure ? find(key) : NULL;
+    if (!_result)
+    {
+        _result = new (_zone) UnaryOperationExpression(node->operation(),
+                expression);
+        if (pure)
+        {
+            _nodes[key] = _result;
+        }
+    }
+    _pure = pure;
+}
+
+void SubexpressionSharing::visitBinaryOperationExpression(
+        BinaryOperationExpression* node)
+{
+    bool leftPure;
+    bool rightPure;
+    Expression* left = copy(node->left(), &leftPure);
+    Expression* right = copy(node->right(), &rightPure);
+    bool pure = leftPure && rightPure;
+
+    // children are already unique, so their addresses identify them
+    Token::Type operation = node->operation();
+    Expression* first = left;
+    Expression* second = right;
+    if ((operation == Token::ADD || operation == Token::MUL) && second < first)
+    {
+        first = right;
+        second = left;
+    }
+    std::string key = "B";
+    key += Token::Name(operation);
+    appendNode(&key, first);
+    appendNode(&key, second);
+
+    _result = pure ? find(key) : NULL;
+    if (!_result)
+    {
+        _result = new (_zone) BinaryOperationExpression(operation, left,
+                right);
+        if (pure)
+        {
+            _nodes[key] = _result;
+        }
+    }
+    _pure = pure;
+}
+
+void SubexpressionSharing::visitFunctionExpression(FunctionExpression* node)
+{
+    Identifier* callee = node->identifier()->asIdentifier();
+    std::string key = "F";
+    if (callee)
+    {
+        Symbol symbol = callee->symbol();
+        appendBytes(&key, &symbol, sizeof(symbol));
+    }
+    key += '(';
+
+    bool pure = callee != NULL;
+    ZoneList<Expression*> arguments;
+    for (int i = 0; i < node->arguments().length(); i++)
+    {
+        bool argumentPure;
+        Expression* argument = copy(node->arguments()[i], &argumentPure);
+        arguments.add(argument, _zone);
+        appendNode(&key, argument);
+        pure = pure && argumentPure;
+    }
+
+    _result = pure ? find(key) : NULL;
+    if (!_result)
+    {
+        Expression* identifier;
+        if (callee)
+        {
+            identifier = copyIdentifier(callee);
+        }
+        else
+        {
+            bool calleePure;
+            identifier = copy(node->identifier(), &calleePure);
+        }
+        FunctionExpression* call = new (_zone) FunctionExpression(identifier,
+                arguments);
+        call->bind(node->builtin());
+        _result = call;
+        if (pure)
+        {
+            _nodes[key] = _result;
+        }
+    }
+    _pure = pure;
+}
+
+void SubexpressionSharing::visitIdentifier(Identifier* node)
+{
+    Symbol symbol = node->symbol();
+    if (_assigned.count(symbol))
+    {
+        _result = copyIdentifier(node);
+        _pure = false;
+        return;
+    }
+
+    std::string key = "I";
+    appendBytes(&key, &symbol, sizeof(symbol));
+    _result = find(key);
+    if (!_result)
+    {
+        _result = copyIdentifier(node);
+        _nodes[key] = _result;
+    }
+    _pure = true;
+}
+
+void SubexpressionSharing::visitNumber(Number* node)
+{
+    // literals are shared only if they are bitwise equal
+    const Value& value = node->value();
+    std::string key = value.isInteger() ? "Ni" : "Nf";
+    if (value.isInteger())
+    {
+        long integer = value.integer();
+        appendBytes(&key, &integer, sizeof(integer));
+    }
+    else
+    {
+        double real = value.real();
+        appendBytes(&key, &real, sizeof(real));
+    }
+    _result = find(key);
+    if (!_result)
+    {
+        _result = new (_zone) Number(value);
+        _nodes[key] = _result;
+    }
+    _pure = true;
+}
+
+} /* Doppio namespace */
@@ -0,0 +1,76 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_SHARING_H_
+#define DOPPIO_SHARING_H_
+
+#include <set>
+#include <string>
+#include <unordered_map>
+#include "ast.h"
+
+namespace Doppio
+{
+
+// Hash-consing pass. Copies a tree into a zone as a DAG in which
+// structurally identical pure subtrees are a single node, so that
+// (x*y+1)^2 / (x*y+1) holds x*y+1 once. Operands of '+' and '*' match in
+// either order.
+//
+// A subtree is pure if it neither assigns nor reads a variable that is
+// assigned anywhere in the tree; impure subtrees are copied as they are.
+// Slots and built-ins already bound are carried over, so the pass may run
+// before or after the Binder. The BytecodeCompiler evaluates each shared
+// node once per evaluation.
+class SubexpressionSharing: public AstVisitor<SubexpressionSharing>
+{
+public:
+    explicit SubexpressionSharing(Zone* zone);
+    ~SubexpressionSharing();
+
+    // Returns the root of the copy. The source tree is left untouched and
+    // its zone may be released afterwards.
+    Expression* share(Expression* expression);
+
+    // Number of nodes that were found to be duplicates in the last call.
+    int sharedCount() const
+    {
+        return _sharedCount;
+    }
+
+#define DECLARE_VISIT(type) void visit##type(type* node);
+    EXPRESSION_NODE_LIST(DECLARE_VISIT)
+#undef DECLARE_VISIT
+
+private:
+    Zone* _zone;
+    std::set<Symbol> _assigned;
+    std::unordered_map<std::string, Expression*> _nodes;
+    Expression* _result;
+    bool _pure;
+    int _sharedCount;
+
+    Expression* copy(Expression* node, bool* pure);
+    Expression* find(const std::string& key);
+    Identifier* copyIdentifier(Identifier* node);
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_SHARING_H_ */
@@ -0,0 +1,139 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <cstring>
+#include "stats.h"
+
+namespace Doppio
+{
+
+namespace
+{
+
+#define NODE_TYPE_NAME(type) #type,
+const char* const kNodeTypeNames[] = { AST_NODE_LIST(NODE_TYPE_NAME) };
+#undef NODE_TYPE_NAME
+
+const char* const kStageNames[] = { "scan_ns", "parse_ns", "compile_ns" };
+
+} /* anonymous namespace */
+
+uint64_t StatsSnapshot::nodeCount() const
+{
+    uint64_t count = 0;
+    for (int i = 0; i < AstNode::kNodeTypeCount; i++)
+    {
+        count += nodes[i];
+    }
+    return count;
+}
+
+void StatsSnapshot::writeJson(FILE* out) const
+{
+    fprintf(out, "{\"tokens\": %llu, \"nodes\": {",
+            (unsigned long long) tokens);
+    for (int i = 0; i < AstNode::kNodeTypeCount; i++)
+    {
+        fprintf(out, "%s\"%s\": %llu", i ? ", " : "", kNodeTypeNames[i],
+                (unsigned long long) nodes[i]);
+    }
+    fprintf(out, "}, \"bytes\": %llu, \"folds\": %llu",
+            (unsigned long long) bytes, (unsigned long long) folds);
+    for (int i = 0; i < NUM_STATS_STAGES; i++)
+    {
+        fprintf(out, ", \"%s\": %llu", kStageNames[i],
+                (unsigned long long) nanoseconds[i]);
+    }
+    fprintf(out, "}\n");
+}
+
+StatsSnapshot operator-(const StatsSnapshot& s1, const StatsSnapshot& s2)
+{
+    StatsSnapshot result;
+    result.tokens = s1.tokens - s2.tokens;
+    for (int i = 0; i < AstNode::kNodeTypeCount; i++)
+    {
+        result.nodes[i] = s1.nodes[i] - s2.nodes[i];
+    }
+    result.bytes = s1.bytes - s2.bytes;
+    result.folds = s1.folds - s2.folds;
+    for (int i = 0; i < NUM_STATS_STAGES; i++)
+    {
+        result.nanoseconds[i] = s1.nanoseconds[i] - s2.nanoseconds[i];
+    }
+    return result;
+}
+
+#ifdef DOPPIO_STATS
+
+std::atomic<uint64_t> Stats::_tokens(0);
+std::atomic<uint64_t> Stats::_nodes[AstNode::kNodeTypeCount];
+std::atomic<uint64_t> Stats::_bytes(0);
+std::atomic<uint64_t> Stats::_folds(0);
+std::atomic<uint64_t> Stats::_nanoseconds[NUM_STATS_STAGES];
+
+StatsSnapshot Stats::Snapshot()
+{
+    StatsSnapshot snapshot;
+    snapshot.tokens = _tokens.load(std::memory_order_relaxed);
+    for (int i = 0; i < AstNode::kNodeTypeCount; i++)
+    {
+        snapshot.nodes[i] = _nodes[i].load(std::memory_order_relaxed);
+    }
+    snapshot.bytes = _bytes.load(std::memory_order_relaxed);
+    snapshot.folds = _folds.load(std::memory_order_relaxed);
+    for (int i = 0; i < NUM_STATS_STAGES; i++)
+    {
+        snapshot.nanoseconds[i] = _nanoseconds[i].load(
+                std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+void Stats::Reset()
+{
+    _tokens.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < AstNode::kNodeTypeCount; i++)
+    {
+        _nodes[i].store(0, std::memory_order_relaxed);
+    }
+    _bytes.store(0, std::memory_order_relaxed);
+    _folds.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < NUM_STATS_STAGES; i++)
+    {
+        _nanoseconds[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+#else
+
+StatsSnapshot Stats::Snapshot()
+{
+    StatsSnapshot snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    return snapshot;
+}
+
+void Stats::Reset()
+{
+}
+
+#endif /* DOPPIO_STATS */
+
+} /* Doppio namespace */
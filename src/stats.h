@@ -0,0 +1,169 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_STATS_H_
+#define DOPPIO_STATS_H_
+
+#include <cstdio>
+#include <stdint.h>
+#include "ast.h"
+
+#ifdef DOPPIO_STATS
+#include <atomic>
+#include <chrono>
+#endif
+
+namespace Doppio
+{
+
+// The stages of preparing a formula that Stats times. Parsing includes
+// scanning when the parser scans the text itself rather than replaying a
+// TokenBuffer; compiling covers BytecodeCompiler and NativeCode.
+enum StatsStage
+{
+    SCAN_STAGE, PARSE_STAGE, COMPILE_STAGE, NUM_STATS_STAGES
+};
+
+// The counters of Stats at one point in time. Subtracting an earlier
+// snapshot gives the work done in between, by all threads.
+struct StatsSnapshot
+{
+    uint64_t tokens;
+    uint64_t nodes[AstNode::kNodeTypeCount];
+    uint64_t bytes;
+    uint64_t folds;
+    uint64_t nanoseconds[NUM_STATS_STAGES];
+
+    uint64_t nodeCount() const;
+
+    // Writes the snapshot as one JSON object.
+    void writeJson(FILE* out) const;
+
+    friend StatsSnapshot operator-(const StatsSnapshot& s1,
+            const StatsSnapshot& s2);
+};
+
+// Process-wide counters of the work of the scanner, the parser and the
+// compilers: tokens scanned, nodes allocated by the parser by node type,
+// zone bytes used by parses, operations the parser folded into constants
+// and the time spent in each stage.
+//
+// Counting is compiled in only if DOPPIO_STATS is defined. Otherwise all
+// functions here are empty and inline, StatsTimer is an empty object and
+// Snapshot() returns zeros, so instrumented code is unchanged. When it is
+// compiled in, every count is one relaxed atomic add.
+class Stats
+{
+public:
+    static bool Enabled()
+    {
+#ifdef DOPPIO_STATS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+#ifdef DOPPIO_STATS
+    static void CountToken()
+    {
+        _tokens.fetch_add(1, std::memory_order_relaxed);
+    }
+    static void CountNode(AstNode::NodeType type)
+    {
+        _nodes[type].fetch_add(1, std::memory_order_relaxed);
+    }
+    static void CountBytes(size_t bytes)
+    {
+        _bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    static void CountFold()
+    {
+        _folds.fetch_add(1, std::memory_order_relaxed);
+    }
+    static void AddTime(StatsStage stage, uint64_t nanoseconds)
+    {
+        _nanoseconds[stage].fetch_add(nanoseconds, std::memory_order_relaxed);
+    }
+#else
+    static void CountToken()
+    {
+    }
+    static void CountNode(AstNode::NodeType)
+    {
+    }
+    static void CountBytes(size_t)
+    {
+    }
+    static void CountFold()
+    {
+    }
+    static void AddTime(StatsStage, uint64_t)
+    {
+    }
+#endif
+
+    static StatsSnapshot Snapshot();
+    static void Reset();
+
+private:
+#ifdef DOPPIO_STATS
+    static std::atomic<uint64_t> _tokens;
+    static std::atomic<uint64_t> _nodes[AstNode::kNodeTypeCount];
+    static std::atomic<uint64_t> _bytes;
+    static std::atomic<uint64_t> _folds;
+    static std::atomic<uint64_t> _nanoseconds[NUM_STATS_STAGES];
+#endif
+};
+
+// Adds the time from its construction to its destruction to a stage.
+class StatsTimer
+{
+public:
+#ifdef DOPPIO_STATS
+    explicit StatsTimer(StatsStage stage) :
+            _stage(stage), _start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~StatsTimer()
+    {
+        Stats::AddTime(_stage, std::chrono::duration_cast<
+                std::chrono::nanoseconds>(std::chrono::steady_clock::now()
+                - _start).count());
+    }
+
+private:
+    StatsStage _stage;
+    std::chrono::steady_clock::time_point _start;
+#else
+    explicit StatsTimer(StatsStage)
+    {
+    }
+#endif
+
+private:
+    // Timers are not copyable.
+    StatsTimer(const StatsTimer&);
+    StatsTimer& operator=(const StatsTimer&);
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_STATS_H_ */
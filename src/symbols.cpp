@@ -0,0 +1,175 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <new>
+#include "symbols.h"
+
+namespace Doppio
+{
+
+namespace
+{
+
+const size_t kInitialIndexSize = 256;
+
+uint32_t hashName(const char* name, size_t length)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ (uint8_t) name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+} /* anonymous namespace */
+
+thread_local SymbolTable* SymbolTable::_current = NULL;
+
+SymbolTable::SymbolTable() :
+        _count(0)
+{
+    memset(_blocks, 0, sizeof(_blocks));
+    _index.store(newIndex(kInitialIndexSize), std::memory_order_relaxed);
+}
+
+SymbolTable::~SymbolTable()
+{
+}
+
+Symbol SymbolTable::intern(const char* name, size_t length)
+{
+    uint32_t hash = hashName(name, length);
+    size_t bucket;
+    Symbol symbol = lookup(_index.load(std::memory_order_acquire), name,
+            length, hash, &bucket);
+    if (symbol != kNoSymbol)
+    {
+        return symbol;
+    }
+
+    // Look again under the lock, the name may have been added meanwhile.
+    std::lock_guard<std::mutex> lock(_mutex);
+    const Index* index = _index.load(std::memory_order_relaxed);
+    symbol = lookup(index, name, length, hash, &bucket);
+    if (symbol != kNoSymbol)
+    {
+        return symbol;
+    }
+
+    symbol = _count;
+    uint32_t block = symbol >> kBlockBits;
+    if (block >= kMaximumBlocks)
+    {
+        return kNoSymbol;
+    }
+    if (!_blocks[block])
+    {
+        _blocks[block] = _zone.newArray<Entry>(kBlockSize);
+    }
+    Entry& entry = _blocks[block][symbol & (kBlockSize - 1)];
+    entry.name = _zone.copyString(name, length);
+    entry.length = (uint32_t) length;
+    entry.hash = hash;
+    index->buckets[bucket].store(symbol + 1, std::memory_order_release);
+    _count++;
+    if (2 * _count > index->mask + 1)
+    {
+        grow();
+    }
+    return symbol;
+}
+
+Symbol SymbolTable::find(const char* name, size_t length) const
+{
+    uint32_t hash = hashName(name, length);
+    size_t bucket;
+    return lookup(_index.load(std::memory_order_acquire), name, length, hash,
+            &bucket);
+}
+
+size_t SymbolTable::size() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _count;
+}
+
+SymbolTable* SymbolTable::Shared()
+{
+    static SymbolTable table;
+    return &table;
+}
+
+// Returns the symbol of the name or kNoSymbol, in which case *bucket is
+// the empty bucket the name belongs in.
+Symbol SymbolTable::lookup(const Index* index, const char* name,
+        size_t length, uint32_t hash, size_t* bucket) const
+{
+    size_t mask = index->mask;
+    for (size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        uint32_t value = index->buckets[i].load(std::memory_order_acquire);
+        if (value == 0)
+        {
+            *bucket = i;
+            return kNoSymbol;
+        }
+        const Entry& candidate = entry(value - 1);
+        if (candidate.hash == hash && candidate.length == length
+                && memcmp(candidate.name, name, length) == 0)
+        {
+            return value - 1;
+        }
+    }
+}
+
+// Allocates an empty index in the zone. Indexes are never freed, a
+// reader may still be probing one that was replaced.
+const SymbolTable::Index* SymbolTable::newIndex(size_t size)
+{
+    Index* index = new (_zone.allocate(sizeof(Index))) Index;
+    index->mask = size - 1;
+    index->buckets = _zone.newArray<std::atomic<uint32_t> >(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        new (&index->buckets[i]) std::atomic<uint32_t>(0);
+    }
+    return index;
+}
+
+// Builds an index of twice the size under the lock and publishes it.
+void SymbolTable::grow()
+{
+    const Index* old = _index.load(std::memory_order_relaxed);
+    const Index* index = newIndex(2 * (old->mask + 1));
+    size_t mask = index->mask;
+    for (Symbol symbol = 0; symbol < _count; symbol++)
+    {
+        size_t i = entry(symbol).hash & mask;
+        while (index->buckets[i].load(std::memory_order_relaxed) != 0)
+        {
+            i = (i + 1) & mask;
+        }
+        index->buckets[i].store(symbol + 1, std::memory_order_relaxed);
+    }
+    _index.store(index, std::memory_order_release);
+}
+
+} /* Doppio namespace */
@@ -0,0 +1,165 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_SYMBOLS_H_
+#define DOPPIO_SYMBOLS_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include "zone.h"
+
+namespace Doppio
+{
+
+// A dense 32-bit handle of an interned identifier name. Two identifiers
+// interned in the same table have the same name exactly if their symbols
+// are equal.
+typedef uint32_t Symbol;
+
+// Interns identifier names. Names are copied once, NUL-terminated, and are
+// never released while the table lives; symbols are handed out densely in
+// interning order. A process that keeps parsing new names, such as a
+// validator or an editor, releases them by interning into tables of its
+// own that it drops from time to time, see SymbolTableScope.
+//
+// The table may be used from many threads at once. Lookups do not lock:
+// a symbol is only published after its entry is written, entries never
+// move and a replaced index is kept until the table dies. intern() takes
+// a lock only to add a name.
+class SymbolTable
+{
+public:
+    static const Symbol kNoSymbol = 0xffffffff;
+
+    SymbolTable();
+    ~SymbolTable();
+
+    // Returns the symbol of the name, adding it if necessary, or
+    // kNoSymbol if the table is full.
+    Symbol intern(const char* name, size_t length);
+
+    // Returns the symbol of the name or kNoSymbol if it was never interned.
+    Symbol find(const char* name, size_t length) const;
+
+    const char* name(Symbol symbol) const
+    {
+        return entry(symbol).name;
+    }
+
+    size_t length(Symbol symbol) const
+    {
+        return entry(symbol).length;
+    }
+
+    // Number of symbols interned so far.
+    size_t size() const;
+
+    // The table the Scanner interns identifiers into and that Scopes and
+    // Identifiers take names from: the one a SymbolTableScope made current
+    // on the calling thread, Shared() otherwise.
+    static SymbolTable* Current()
+    {
+        return _current ? _current : Shared();
+    }
+
+    // The table of all parses outside a SymbolTableScope, so that symbols
+    // from different formulas compare directly. It lives as long as the
+    // process.
+    static SymbolTable* Shared();
+
+private:
+    friend class SymbolTableScope;
+
+    static thread_local SymbolTable* _current;
+
+    static const int kBlockBits = 12;
+    static const uint32_t kBlockSize = 1 << kBlockBits;
+    static const uint32_t kMaximumBlocks = 4096;
+
+    struct Entry
+    {
+        const char* name;
+        uint32_t length;
+        uint32_t hash;
+    };
+
+    // Entries live in fixed-size blocks so that readers never see them move.
+    Entry* _blocks[kMaximumBlocks];
+    uint32_t _count;
+
+    // Open addressing hash index of symbol + 1, 0 for an empty bucket.
+    // Buckets only ever go from empty to full.
+    struct Index
+    {
+        size_t mask;
+        std::atomic<uint32_t>* buckets;
+    };
+
+    std::atomic<const Index*> _index;
+
+    Zone _zone;
+    mutable std::mutex _mutex;
+
+    const Entry& entry(Symbol symbol) const
+    {
+        ASSERT(symbol >> kBlockBits < kMaximumBlocks);
+        return _blocks[symbol >> kBlockBits][symbol & (kBlockSize - 1)];
+    }
+
+    Symbol lookup(const Index* index, const char* name, size_t length,
+            uint32_t hash, size_t* bucket) const;
+    const Index* newIndex(size_t size);
+    void grow();
+
+    // Symbol tables are not copyable.
+    SymbolTable(const SymbolTable&);
+    SymbolTable& operator=(const SymbolTable&);
+};
+
+// Makes a table current on the calling thread for the lifetime of the
+// scope; scopes nest. Trees, Scopes and symbols made meanwhile belong to
+// the table: they must not be mixed with those of another table and must
+// not be used once it is destroyed. Threads start without a current
+// table, ParallelParser passes its caller's on to its threads.
+class SymbolTableScope
+{
+public:
+    explicit SymbolTableScope(SymbolTable* table) :
+            _previous(SymbolTable::_current)
+    {
+        SymbolTable::_current = table;
+    }
+
+    ~SymbolTableScope()
+    {
+        SymbolTable::_current = _previous;
+    }
+
+private:
+    SymbolTable* _previous;
+
+    // Symbol table scopes are not copyable.
+    SymbolTableScope(const SymbolTableScope&);
+    SymbolTableScope& operator=(const SymbolTableScope&);
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_SYMBOLS_H_ */
@@ -0,0 +1,213 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "tokens.h"
+#include "scanner.h"
+#include "stats.h"
+
+namespace Doppio
+{
+
+TokenBuffer::TokenBuffer() :
+        _length(0)
+{
+    setStorage(_inline, kInlineCapacity);
+}
+
+TokenBuffer::~TokenBuffer()
+{
+    if (_payloads != _inline)
+    {
+        free(_payloads);
+    }
+}
+
+void TokenBuffer::tokenize(const char* input, size_t length)
+{
+    ASSERT(length <= UINT32_MAX);
+    StatsTimer timer(SCAN_STAGE);
+    clear();
+
+    // a guess that is right for typical formulas, the arrays double when
+    // it is too small
+    if ((size_t) _capacity < length / 4)
+    {
+        grow((int) (length / 4));
+    }
+
+    Scanner scanner(input, length);
+    Token::Type type;
+    do
+    {
+        if (_length == _capacity)
+        {
+            grow(2 * _capacity);
+        }
+        type = scanner.next();
+        set(_length++, scanner.currentToken());
+    } while (type != Token::EOS);
+}
+
+TokenEdit TokenBuffer::retokenize(const char* input, size_t length,
+        size_t offset, size_t removed, size_t inserted)
+{
+    ASSERT(_length > 0 && length <= UINT32_MAX);
+    ASSERT(offset + removed <= end(_length - 1));
+    StatsTimer timer(SCAN_STAGE);
+    TokenEdit edit;
+
+    // a token is unchanged if it ends before the edit: the scanner looks
+    // one byte past the end of a token, so one that ends at the offset
+    // may be extended by the edit
+    int low = 0;
+    int high = _length - 1;
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        if (end(middle) < offset)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    edit.first = low;
+
+    // scan from the end of the last unchanged token until a token starts
+    // behind the edit where a token started before; the scanner restarts
+    // at every token, so all tokens from there on are the old ones. The
+    // final EOS always matches.
+    size_t position = edit.first > 0 ? end(edit.first - 1) : 0;
+    long delta = (long) inserted - (long) removed;
+    Scanner scanner(input + position, length - position);
+    std::vector<Token> scanned;
+    while (true)
+    {
+        scanner.next();
+        Token token = scanner.currentToken();
+        token.start += position;
+        token.end += position;
+        if (token.start >= offset + inserted)
+        {
+            edit.oldEnd = findStart(edit.first, (uint32_t) (token.start
+                    - delta));
+            if (edit.oldEnd >= 0)
+            {
+                break;
+            }
+        }
+        scanned.push_back(token);
+    }
+    edit.newEnd = edit.first + (int) scanned.size();
+
+    // move the tail into place and store the new tokens
+    int tail = _length - edit.oldEnd;
+    if (edit.newEnd + tail > _capacity)
+    {
+        grow(2 * (edit.newEnd + tail));
+    }
+    memmove(&_payloads[edit.newEnd], &_payloads[edit.oldEnd],
+            tail * sizeof(Payload));
+    memmove(&_starts[edit.newEnd], &_starts[edit.oldEnd],
+            tail * sizeof(uint32_t));
+    memmove(&_lengths[edit.newEnd], &_lengths[edit.oldEnd],
+            tail * sizeof(uint32_t));
+    memmove(&_types[edit.newEnd], &_types[edit.oldEnd],
+            tail * sizeof(uint8_t));
+    _length = edit.newEnd + tail;
+    for (int i = edit.newEnd; i < _length; i++)
+    {
+        _starts[i] += (uint32_t) delta;
+    }
+    for (size_t i = 0; i < scanned.size(); i++)
+    {
+        set(edit.first + (int) i, scanned[i]);
+    }
+    return edit;
+}
+
+void TokenBuffer::clear()
+{
+    _length = 0;
+}
+
+void TokenBuffer::grow(int capacity)
+{
+    Payload* payloads = _payloads;
+    uint32_t* starts = _starts;
+    uint32_t* lengths = _lengths;
+    uint8_t* types = _types;
+
+    void* block = malloc(capacity * kBytesPerToken);
+    ASSERT(block != NULL);
+    setStorage(block, capacity);
+    memcpy(_payloads, payloads, _length * sizeof(Payload));
+    memcpy(_starts, starts, _length * sizeof(uint32_t));
+    memcpy(_lengths, lengths, _length * sizeof(uint32_t));
+    memcpy(_types, types, _length * sizeof(uint8_t));
+    if (payloads != _inline)
+    {
+        free(payloads);
+    }
+}
+
+void TokenBuffer::set(int i, const Token& token)
+{
+    memcpy(&_payloads[i], &token.real, sizeof(Payload));
+    _starts[i] = (uint32_t) token.start;
+    _lengths[i] = (uint32_t) (token.end - token.start);
+    _types[i] = (uint8_t) token.type;
+}
+
+// Returns the index of the token from first on that starts at start, or
+// -1 if there is none.
+int TokenBuffer::findStart(int first, uint32_t start) const
+{
+    int low = first;
+    int high = _length;
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        if (_starts[middle] < start)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low < _length && _starts[low] == start ? low : -1;
+}
+
+void TokenBuffer::setStorage(void* block, int capacity)
+{
+    _payloads = (Payload*) block;
+    _starts = (uint32_t*) (_payloads + capacity);
+    _lengths = _starts + capacity;
+    _types = (uint8_t*) (_lengths + capacity);
+    _capacity = capacity;
+}
+
+} /* Doppio namespace */
@@ -0,0 +1,143 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_TOKENS_H_
+#define DOPPIO_TOKENS_H_
+
+#include <stdint.h>
+#include <cstring>
+#include "token.h"
+
+namespace Doppio
+{
+
+// The tokens that an edit of the input changed, see
+// TokenBuffer::retokenize(). Tokens before first are unchanged; the
+// tokens that were at oldEnd and after are now at newEnd and after, with
+// the same contents moved by the size difference of the edit. The tokens
+// in between were scanned again.
+struct TokenEdit
+{
+    int first;
+    int oldEnd;
+    int newEnd;
+};
+
+// The tokens of a whole input, scanned in one pass and stored as parallel
+// arrays: one byte of type and 32-bit start and length offsets per token,
+// plus the symbol or literal value that the Scanner attaches to the token.
+// The last token is always EOS. Any token may be inspected by index.
+//
+// A buffer is meant to be reused: tokenize() replaces the contents but
+// keeps the storage, so scanning many inputs stops allocating once the
+// largest has been seen. Inputs of up to kInlineCapacity tokens need no
+// allocation at all.
+class TokenBuffer
+{
+public:
+    static const int kInlineCapacity = 64;
+
+    TokenBuffer();
+    ~TokenBuffer();
+
+    // Scans input, replacing the previous tokens. The input must be
+    // shorter than 4 GB.
+    void tokenize(const char* input, size_t length);
+
+    // Updates the tokens after an edit that replaced removed bytes at
+    // offset by inserted bytes; input is the edited text. Only the tokens
+    // from the one before the edit up to the first one behind it that
+    // starts where a token started before are scanned again.
+    TokenEdit retokenize(const char* input, size_t length, size_t offset,
+            size_t removed, size_t inserted);
+
+    void clear();
+
+    // Number of tokens, including the final EOS.
+    int length() const
+    {
+        return _length;
+    }
+
+    Token::Type type(int i) const
+    {
+        ASSERT(i >= 0 && i < length());
+        return (Token::Type) _types[i];
+    }
+
+    uint32_t start(int i) const
+    {
+        ASSERT(i >= 0 && i < length());
+        return _starts[i];
+    }
+
+    uint32_t end(int i) const
+    {
+        ASSERT(i >= 0 && i < length());
+        return _starts[i] + _lengths[i];
+    }
+
+    // Assembles the i-th token.
+    Token at(int i) const
+    {
+        ASSERT(i >= 0 && i < length());
+        Token token;
+        token.type = (Token::Type) _types[i];
+        token.start = _starts[i];
+        token.end = _starts[i] + _lengths[i];
+        memcpy(&token.real, &_payloads[i], sizeof(Payload));
+        return token;
+    }
+
+private:
+    // The payload of a token: its symbol, integer or real.
+    union Payload
+    {
+        Symbol symbol;
+        long integer;
+        double real;
+    };
+
+    // The four arrays share one block of storage, either _inline or
+    // malloc'ed. They only grow; the first _length entries are valid.
+    Payload* _payloads;
+    uint32_t* _starts;
+    uint32_t* _lengths;
+    uint8_t* _types;
+    int _length;
+    int _capacity;
+
+    static const size_t kBytesPerToken = sizeof(Payload)
+            + 2 * sizeof(uint32_t) + sizeof(uint8_t);
+    Payload _inline[(kInlineCapacity * kBytesPerToken + sizeof(Payload) - 1)
+            / sizeof(Payload)];
+
+    void grow(int capacity);
+    void setStorage(void* block, int capacity);
+    void set(int i, const Token& token);
+    int findStart(int first, uint32_t start) const;
+
+    // Token buffers are not copyable.
+    TokenBuffer(const TokenBuffer&);
+    TokenBuffer& operator=(const TokenBuffer&);
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_TOKENS_H_ */
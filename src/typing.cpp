@@ -0,0 +1,122 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "typing.h"
+
+namespace Doppio
+{
+
+TypeInference::TypeInference()
+{
+}
+
+TypeInference::~TypeInference()
+{
+}
+
+StaticType TypeInference::infer(Expression* expression)
+{
+    _visited.clear();
+    return typeOf(expression);
+}
+
+// Visits each node of a shared subtree once.
+StaticType TypeInference::typeOf(Expression* node)
+{
+    if (_visited.insert(node).second)
+    {
+        visit(node);
+    }
+    return node->staticType();
+}
+
+StaticType TypeInference::BinaryType(Token::Type operation, StaticType left,
+        Expression* right, StaticType rightType)
+{
+    switch (operation)
+    {
+    case Token::DIV:
+    case Token::POW:
+        return REAL_TYPE;
+    case Token::MOD:
+        // integer remainder by zero is NaN
+        if (left == REAL_TYPE || rightType == REAL_TYPE)
+        {
+            return REAL_TYPE;
+        }
+        if (left == INTEGER_TYPE && right->asNumber()
+                && right->asNumber()->integer() != 0)
+        {
+            return INTEGER_TYPE;
+        }
+        return UNKNOWN_TYPE;
+    default:
+        if (left == REAL_TYPE || rightType == REAL_TYPE)
+        {
+            return REAL_TYPE;
+        }
+        if (left == INTEGER_TYPE && rightType == INTEGER_TYPE)
+        {
+            return INTEGER_TYPE;
+        }
+        return UNKNOWN_TYPE;
+    }
+}
+
+void TypeInference::visitAssignmentExpression(AssignmentExpression* node)
+{
+    node->setStaticType(AssignmentType(node->target()->asIdentifier(),
+            typeOf(node->value())));
+}
+
+void TypeInference::visitUnaryOperationExpression(
+        UnaryOperationExpression* node)
+{
+    ASSERT(node->operation() == Token::FACTORIAL);
+    typeOf(node->expression());
+    node->setStaticType(INTEGER_TYPE);
+}
+
+void TypeInference::visitBinaryOperationExpression(
+        BinaryOperationExpression* node)
+{
+    StaticType left = typeOf(node->left());
+    StaticType right = typeOf(node->right());
+    node->setStaticType(BinaryType(node->operation(), left, node->right(),
+            right));
+}
+
+void TypeInference::visitFunctionExpression(FunctionExpression* node)
+{
+    for (int i = 0; i < node->arguments().length(); i++)
+    {
+        typeOf(node->arguments()[i]);
+    }
+    node->setStaticType(REAL_TYPE);
+}
+
+void TypeInference::visitIdentifier(Identifier*)
+{
+}
+
+void TypeInference::visitNumber(Number*)
+{
+}
+
+} /* Doppio namespace */
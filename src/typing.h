@@ -0,0 +1,73 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_TYPING_H_
+#define DOPPIO_TYPING_H_
+
+#include <unordered_set>
+#include "ast.h"
+
+namespace Doppio
+{
+
+// Static type inference. Annotates every node of a bound tree with the
+// type of the values it produces, following the rules of Value: '+', '-'
+// and '*' are integral if both operands are, '/', '^' and built-in calls
+// always give reals and '!' always gives integers. An integer remainder
+// is known to be integral only if its divisor is a non-zero literal,
+// since a remainder by zero is a real NaN. Assignments convert to the
+// type their variable was declared with.
+//
+// Identifiers keep the type the Binder gave them; a tree that has not
+// been bound stays UNKNOWN_TYPE wherever it reads a variable. The
+// BytecodeCompiler and NativeCode run the pass themselves.
+class TypeInference: public AstVisitor<TypeInference>
+{
+public:
+    TypeInference();
+    ~TypeInference();
+
+    // Returns the type of the root.
+    StaticType infer(Expression* expression);
+
+    // The type of left <operation> right for operands of the given types.
+    // The right operand itself is needed for '%'.
+    static StaticType BinaryType(Token::Type operation, StaticType left,
+            Expression* right, StaticType rightType);
+
+    // The type of an assignment of a value of the given type.
+    static StaticType AssignmentType(Identifier* target, StaticType value)
+    {
+        return target->staticType() != UNKNOWN_TYPE ?
+                target->staticType() : value;
+    }
+
+#define DECLARE_VISIT(type) void visit##type(type* node);
+    EXPRESSION_NODE_LIST(DECLARE_VISIT)
+#undef DECLARE_VISIT
+
+private:
+    std::unordered_set<Expression*> _visited;
+
+    StaticType typeOf(Expression* node);
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_TYPING_H_ */
@@ -0,0 +1,208 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_VALUE_H_
+#define DOPPIO_VALUE_H_
+
+#include <climits>
+#include <cmath>
+#include "token.h"
+
+namespace Doppio
+{
+
+// What is known about the type of the values of an expression before it is
+// evaluated, see TypeInference. An expression of UNKNOWN_TYPE may produce
+// integers or reals, which is told at run time by the tag of the Value.
+enum StaticType
+{
+    UNKNOWN_TYPE, INTEGER_TYPE, REAL_TYPE
+};
+
+// A number computed at parse or evaluation time. Values are either
+// integers (NUMBER_INTEGER) or reals (NUMBER_FLOAT); arithmetic on two
+// integers stays integral except for '/' and '^', which always produce
+// reals.
+class Value
+{
+private:
+    Token::Type _type;
+    union
+    {
+        double _real;
+        long _integer;
+    };
+
+public:
+    Value() :
+            _type(Token::NUMBER_INTEGER), _integer(0)
+    {
+    }
+
+    Value(double value) :
+            _type(Token::NUMBER_FLOAT), _real(value)
+    {
+    }
+
+    Value(long value) :
+            _type(Token::NUMBER_INTEGER), _integer(value)
+    {
+    }
+
+    Value(int value) :
+            _type(Token::NUMBER_INTEGER), _integer(value)
+    {
+    }
+
+    Token::Type type() const
+    {
+        return _type;
+    }
+
+    bool isInteger() const
+    {
+        return _type == Token::NUMBER_INTEGER;
+    }
+
+    double real() const
+    {
+        return _type == Token::NUMBER_FLOAT ? _real : (double) _integer;
+    }
+
+    long integer() const
+    {
+        return _type == Token::NUMBER_INTEGER ? _integer : (long) _real;
+    }
+
+    // Unchecked accessors for values whose type is known statically. They
+    // do not test the tag, not even with assertions, as they are meant for
+    // the inner loops of type-specialized code.
+    long asInteger() const
+    {
+        return _integer;
+    }
+
+    double asReal() const
+    {
+        return _real;
+    }
+
+    // The value as stored in a variable of the given type: reals are
+    // truncated to integers and integers widened to reals.
+    Value convertTo(StaticType type) const
+    {
+        switch (type)
+        {
+        case INTEGER_TYPE:
+            return Value(integer());
+        case REAL_TYPE:
+            return Value(real());
+        default:
+            return *this;
+        }
+    }
+
+    // Integer sums, differences and products wrap around; computing them
+    // in unsigned long keeps the overflow defined.
+    friend Value operator+(const Value &c1, const Value &c2)
+    {
+        if (c1.isInteger() && c2.isInteger())
+        {
+            return Value((long) ((unsigned long) c1._integer + c2._integer));
+        }
+        return Value(c1.real() + c2.real());
+    }
+
+    friend Value operator-(const Value &c1, const Value &c2)
+    {
+        if (c1.isInteger() && c2.isInteger())
+        {
+            return Value((long) ((unsigned long) c1._integer - c2._integer));
+        }
+        return Value(c1.real() - c2.real());
+    }
+
+    friend Value operator*(const Value &c1, const Value &c2)
+    {
+        if (c1.isInteger() && c2.isInteger())
+        {
+            return Value((long) ((unsigned long) c1._integer * c2._integer));
+        }
+        return Value(c1.real() * c2.real());
+    }
+
+    friend Value operator/(const Value &c1, const Value &c2)
+    {
+        return Value(c1.real() / c2.real());
+    }
+
+    friend Value operator%(const Value &c1, const Value &c2)
+    {
+        // integer remainder by zero has no value, it falls through to the
+        // real formula and yields NaN
+        if (c1.isInteger() && c2.isInteger() && c2._integer != 0)
+        {
+            if (c2._integer == -1)
+            {
+                // LONG_MIN % -1 overflows
+                return Value(0L);
+            }
+            return Value(c1._integer % c2._integer);
+        }
+        double x = c1.real();
+        double n = c2.real();
+        return Value(x - n * floor(x / n));
+    }
+
+    friend Value operator^(const Value &c1, const Value &c2)
+    {
+        return Value(pow(c1.real(), c2.real()));
+    }
+
+    // Factorial is defined for integers only, reals are truncated first.
+    // Factorials that overflow a long saturate to LONG_MAX, as does NaN,
+    // so the loop stops after 20 steps. Reals are compared before they
+    // are truncated, which would overflow for large values.
+    static Value factorial(const Value &c)
+    {
+        if (c.isInteger() ? c._integer < 2 : c._real < 2.0)
+        {
+            return Value(1L);
+        }
+        if (!c.isInteger() && !(c._real < LONG_MAX))
+        {
+            return Value(LONG_MAX);
+        }
+        long n = c.integer();
+        long result = 1;
+        for (long i = 2; i <= n; i++)
+        {
+            if (result > LONG_MAX / i)
+            {
+                return Value(LONG_MAX);
+            }
+            result *= i;
+        }
+        return Value(result);
+    }
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_VALUE_H_ */
@@ -0,0 +1,103 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "zone.h"
+
+namespace Doppio
+{
+
+Zone::Zone() :
+        _head(NULL), _position(NULL), _limit(NULL), _allocationSize(0),
+        _segmentBytes(0), _segmentAllocations(0)
+{
+}
+
+Zone::~Zone()
+{
+    deleteAll();
+    if (_head)
+    {
+        free(_head);
+    }
+}
+
+void Zone::deleteAll()
+{
+    Segment* keep = NULL;
+    Segment* segment = _head;
+    while (segment)
+    {
+        Segment* next = segment->next;
+        if (!keep && segment->size <= kMaximumSegmentSize)
+        {
+            keep = segment;
+        }
+        else
+        {
+            free(segment);
+        }
+        segment = next;
+    }
+
+    _head = keep;
+    _allocationSize = 0;
+    if (keep)
+    {
+        keep->next = NULL;
+        _position = (char*) keep + sizeof(Segment);
+        _limit = (char*) keep + keep->size;
+        _segmentBytes = keep->size;
+    }
+    else
+    {
+        _position = NULL;
+        _limit = NULL;
+        _segmentBytes = 0;
+    }
+}
+
+void* Zone::newSegment(size_t size)
+{
+    // Grow segments geometrically to keep the number of mallocs
+    // logarithmic in the size of the tree.
+    size_t segmentSize = _head ? 2 * _head->size : kMinimumSegmentSize;
+    if (segmentSize > kMaximumSegmentSize)
+    {
+        segmentSize = kMaximumSegmentSize;
+    }
+    if (segmentSize < sizeof(Segment) + size)
+    {
+        segmentSize = sizeof(Segment) + size;
+    }
+
+    Segment* segment = (Segment*) malloc(segmentSize);
+    ASSERT(segment != NULL);
+    segment->next = _head;
+    segment->size = segmentSize;
+    _head = segment;
+    _segmentBytes += segmentSize;
+    _segmentAllocations++;
+
+    char* result = (char*) segment + sizeof(Segment);
+    _position = result + size;
+    _limit = (char*) segment + segmentSize;
+    return result;
+}
+
+} /* Doppio namespace */
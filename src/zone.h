@@ -0,0 +1,186 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_ZONE_H_
+#define DOPPIO_ZONE_H_
+
+#include <cstdlib>
+#include <cstring>
+#include "asserts.h"
+
+namespace Doppio
+{
+
+// A Zone is an arena allocator. Memory is handed out by bumping a pointer
+// inside large segments and is released all at once by deleteAll() or by
+// the destructor. Destructors of objects allocated in a zone are never run.
+class Zone
+{
+public:
+    Zone();
+    ~Zone();
+
+    void* allocate(size_t size)
+    {
+        size = (size + kAlignment - 1) & ~(kAlignment - 1);
+        _allocationSize += size;
+        if (size > (size_t) (_limit - _position))
+        {
+            return newSegment(size);
+        }
+        void* result = _position;
+        _position += size;
+        return result;
+    }
+
+    template<typename T>
+    T* newArray(size_t length)
+    {
+        return (T*) allocate(length * sizeof(T));
+    }
+
+    // Copies length bytes of str into the zone and terminates the copy
+    // with '\0'.
+    char* copyString(const char* str, size_t length)
+    {
+        char* result = newArray<char>(length + 1);
+        memcpy(result, str, length);
+        result[length] = '\0';
+        return result;
+    }
+
+    // Releases everything allocated in the zone. The most recent segment
+    // is kept unless it is oversized, so a zone reused for many small
+    // parses does not go back to malloc.
+    void deleteAll();
+
+    // Number of bytes handed out since the last deleteAll().
+    size_t allocationSize() const
+    {
+        return _allocationSize;
+    }
+
+    // Number of bytes currently held in segments.
+    size_t segmentBytes() const
+    {
+        return _segmentBytes;
+    }
+
+    // Number of calls to malloc made since the zone was created.
+    size_t segmentAllocations() const
+    {
+        return _segmentAllocations;
+    }
+
+private:
+    static const size_t kAlignment = 8;
+    static const size_t kMinimumSegmentSize = 8 * 1024;
+    static const size_t kMaximumSegmentSize = 1024 * 1024;
+
+    struct Segment
+    {
+        Segment* next;
+        size_t size;
+    };
+
+    Segment* _head;
+    char* _position;
+    char* _limit;
+    size_t _allocationSize;
+    size_t _segmentBytes;
+    size_t _segmentAllocations;
+
+    void* newSegment(size_t size);
+
+    // Zones are not copyable.
+    Zone(const Zone&);
+    Zone& operator=(const Zone&);
+};
+
+// Base class for objects that live in a zone. They are created with
+// new (zone) T(...) and are freed together with their zone.
+class ZoneObject
+{
+public:
+    void* operator new(size_t size, Zone* zone)
+    {
+        return zone->allocate(size);
+    }
+
+    // Zone objects are released with their zone, so deleting one is a no-op.
+    void operator delete(void*, size_t)
+    {
+    }
+
+    void operator delete(void*, Zone*)
+    {
+    }
+};
+
+// A growable array whose backing store lives in a zone.
+template<typename T>
+class ZoneList
+{
+public:
+    ZoneList() :
+            _data(NULL), _length(0), _capacity(0)
+    {
+    }
+
+    int length() const
+    {
+        return _length;
+    }
+
+    T& operator[](int i) const
+    {
+        ASSERT(i >= 0 && i < _length);
+        return _data[i];
+    }
+
+    T& at(int i) const
+    {
+        return operator[](i);
+    }
+
+    void add(const T& element, Zone* zone)
+    {
+        if (_length == _capacity)
+        {
+            int capacity = _capacity == 0 ? 4 : 2 * _capacity;
+            T* data = zone->newArray<T>(capacity);
+            if (_length > 0)
+            {
+                memcpy(data, _data, _length * sizeof(T));
+            }
+            _data = data;
+            _capacity = capacity;
+        }
+        _data[_length++] = element;
+    }
+
+private:
+    T* _data;
+    int _length;
+    int _capacity;
+};
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_ZONE_H_ */
@@ -0,0 +1,136 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Computes the gradients of generated formulas with a GradientTape and
+// compares every component with the tree of the Differentiator for that
+// variable, evaluated by the Evaluator. The two are computed along
+// different paths, so they are compared with a tolerance relative to the
+// value, and points where either is not finite are left out.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include "binder.h"
+#include "derivative.h"
+#include "evaluator.h"
+#include "generator.h"
+#include "test.h"
+
+using namespace Doppio;
+
+namespace
+{
+
+const int kFormulas = 3000;
+const int kPoints = 8;
+const double kTolerance = 1e-9;
+
+// Terms that cancel leave rounding errors of the size of the terms, which
+// are at least as large as the value itself.
+bool close(double a, double b, double value)
+{
+    double scale = std::max(std::max(1.0, std::fabs(value)),
+            std::max(std::fabs(a), std::fabs(b)));
+    return std::fabs(a - b) <= kTolerance * scale;
+}
+
+void testFormula(TestResult* result, const std::string& formula)
+{
+    Zone zone;
+    Scope scope;
+    Parser parser(formula.data(), formula.size(), &zone);
+    Expression* expression = parser.parse().expression;
+    Binder binder(&scope);
+    result->check(expression != NULL && binder.bind(expression),
+            "'%s' does not bind", formula.c_str());
+    if (expression == NULL)
+    {
+        return;
+    }
+    int variableCount = scope.variableCount();
+    std::vector<Expression*> derivatives(variableCount);
+    Differentiator differentiator(&zone);
+    for (int slot = 0; slot < variableCount; slot++)
+    {
+        derivatives[slot] = differentiator.differentiate(expression, slot);
+        result->check(derivatives[slot] != NULL,
+                "'%s' cannot be differentiated", formula.c_str());
+        if (derivatives[slot] == NULL)
+        {
+            return;
+        }
+    }
+
+    GradientTape tape(expression, &scope);
+    std::vector<double> variables(variableCount);
+    std::vector<double> gradient(variableCount);
+    std::vector<Value> environment(variableCount);
+    for (int point = 0; point < kPoints; point++)
+    {
+        // away from 0 and 1, where many of the built-ins have kinks
+        for (int slot = 0; slot < variableCount; slot++)
+        {
+            variables[slot] = 0.3 + (rand() % 1000) * 0.0012;
+            environment[slot] = Value(variables[slot]);
+        }
+        double value = tape.evaluate(variables.data(), gradient.data());
+        double expected = Evaluator(expression).evaluate(
+                environment.data()).real();
+        if (!std::isfinite(value) || !std::isfinite(expected))
+        {
+            continue;
+        }
+        result->check(close(value, expected, expected),
+                "'%s' is %.17g on the tape, not %.17g", formula.c_str(),
+                value, expected);
+        for (int slot = 0; slot < variableCount; slot++)
+        {
+            double derivative = Evaluator(derivatives[slot]).evaluate(
+                    environment.data()).real();
+            if (std::isfinite(gradient[slot]) && std::isfinite(derivative))
+            {
+                result->check(close(gradient[slot], derivative, value),
+                        "'%s' d/d%s is %.17g on the tape, not %.17g",
+                        formula.c_str(), scope.variableName(slot),
+                        gradient[slot], derivative);
+            }
+        }
+    }
+}
+
+} /* anonymous namespace */
+
+int main()
+{
+    TestResult result("derivative");
+    srand(1);
+    for (int i = 0; i < kFormulas; i++)
+    {
+        FormulaGenerator::Options options;
+        options.depth = 1 + i % 4;
+        options.width = 1 + i % 5;
+        options.identifierCount = 3;
+        options.seed = i + 1;
+        std::string formula;
+        FormulaGenerator(options).generate(&formula);
+        testFormula(&result, formula);
+    }
+    return result.finish();
+}
@@ -0,0 +1,249 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Evaluates generated formulas with every evaluator and compares them to
+// the Evaluator, which implements Value semantics directly: the
+// Interpreter, FlatEvaluator, BatchInterpreter and CompiledExpression,
+// and the Evaluator again over the trees of the Optimizer and of
+// SubexpressionSharing. Variables take integer and real values, and some
+// are declared 'int' or 'double'.
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "batch.h"
+#include "binder.h"
+#include "compiler.h"
+#include "evaluator.h"
+#include "flat.h"
+#include "generator.h"
+#include "interpreter.h"
+#include "jit.h"
+#include "optimizer.h"
+#include "sharing.h"
+#include "test.h"
+
+using namespace Doppio;
+
+namespace
+{
+
+const int kFormulas = 2000;
+
+// Rows per formula, more than a block of the BatchInterpreter so that a
+// partial block is evaluated as well.
+const int kRows = BatchInterpreter::kBlockSize + 5;
+
+// Generated variables are x0 to x3; x1 is declared 'int' and x2
+// 'double'.
+const int kIdentifiers = 4;
+
+Expression* parseAndBind(const std::string& formula, Zone* zone,
+        Scope* scope)
+{
+    scope->declare("x1", 2, INTEGER_TYPE);
+    scope->declare("x2", 2, REAL_TYPE);
+    Parser parser(formula.data(), formula.size(), zone);
+    Expression* expression = parser.parse().expression;
+    Binder binder(scope);
+    if (expression == NULL || !binder.bind(expression))
+    {
+        return NULL;
+    }
+    return expression;
+}
+
+// Integers from -6 to 6 and reals from -3 to 3 in steps of 1/4, with -0.
+Value randomValue(Token::Type type)
+{
+    int step = rand() % 25 - 12;
+    if (type == Token::NUMBER_INTEGER)
+    {
+        return Value((long) step / 2);
+    }
+    return step == 0 && rand() % 2 ? Value(-0.0) : Value(step * 0.25);
+}
+
+// Variables of typed slots are compared as the program reads them.
+bool sameEnvironment(const Scope& scope, const std::vector<Value>& a,
+        const std::vector<Value>& b)
+{
+    for (size_t slot = 0; slot < a.size(); slot++)
+    {
+        StaticType type = scope.variableType((int) slot);
+        if (!SameValue(a[slot].convertTo(type), b[slot].convertTo(type)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+class FormulaTest
+{
+public:
+    FormulaTest(TestResult* result, const std::string& formula) :
+            _result(result), _formula(formula)
+    {
+    }
+
+    void run()
+    {
+        Zone zone;
+        Scope scope;
+        Expression* expression = parseAndBind(_formula, &zone, &scope);
+        _result->check(expression != NULL, "'%s' does not bind",
+                _formula.c_str());
+        if (expression == NULL)
+        {
+            return;
+        }
+        int variableCount = scope.variableCount();
+
+        // the passes work on a copy, so they cannot disturb the reference
+        Scope copyScope;
+        Expression* copy = parseAndBind(_formula, &zone, &copyScope);
+        Expression* optimized = Optimizer(&zone).optimize(copy);
+        Expression* shared = SubexpressionSharing(&zone).share(copy);
+
+        Bytecode* bytecode = BytecodeCompiler().compile(expression, &scope);
+        _result->check(bytecode != NULL, "'%s' does not compile",
+                _formula.c_str());
+        if (bytecode == NULL)
+        {
+            return;
+        }
+        Interpreter interpreter(bytecode);
+        FlatTree flatTree(expression);
+        FlatEvaluator flatEvaluator(&flatTree);
+        CompiledExpression compiled(expression, &scope);
+
+        // every column has one type, the rows random values of it
+        std::vector<Token::Type> columnTypes(variableCount);
+        for (int slot = 0; slot < variableCount; slot++)
+        {
+            columnTypes[slot] = rand() % 2 ?
+                    Token::NUMBER_INTEGER : Token::NUMBER_FLOAT;
+        }
+        std::vector<std::vector<BatchInterpreter::Cell> > columns(
+                variableCount, std::vector<BatchInterpreter::Cell>(kRows));
+        std::vector<const void*> columnPointers(variableCount);
+        std::vector<std::vector<Value> > rows(kRows,
+                std::vector<Value>(variableCount));
+        for (int slot = 0; slot < variableCount; slot++)
+        {
+            for (int row = 0; row < kRows; row++)
+            {
+                Value value = randomValue(columnTypes[slot]);
+                rows[row][slot] = value;
+                if (value.isInteger())
+                {
+                    columns[slot][row].integer = value.integer();
+                }
+                else
+                {
+                    columns[slot][row].real = value.real();
+                }
+            }
+            columnPointers[slot] = columns[slot].data();
+        }
+        BatchInterpreter batch(bytecode, columnTypes.data());
+        double batchResults[kRows];
+        batch.evaluate(columnPointers.data(), kRows, batchResults);
+
+        for (int row = 0; row < kRows; row++)
+        {
+            std::vector<Value> environment = rows[row];
+            Value expected = Evaluator(expression).evaluate(
+                    environment.data());
+            compare(scope, rows[row], expected, environment, "Interpreter",
+                    interpreter);
+            compare(scope, rows[row], expected, environment,
+                    "FlatEvaluator", flatEvaluator);
+            Evaluator optimizedEvaluator(optimized);
+            compare(scope, rows[row], expected, environment, "Optimizer",
+                    optimizedEvaluator);
+            Evaluator sharedEvaluator(shared);
+            compare(scope, rows[row], expected, environment,
+                    "SubexpressionSharing", sharedEvaluator);
+            _result->check(SameReal(batchResults[row], expected.real()),
+                    "BatchInterpreter: '%s' row %d gives %.17g, not %s",
+                    _formula.c_str(), row, batchResults[row],
+                    ValueString(expected).c_str());
+
+            // compiled expressions take every variable as a double
+            std::vector<double> variables(variableCount);
+            std::vector<Value> realEnvironment(variableCount);
+            for (int slot = 0; slot < variableCount; slot++)
+            {
+                variables[slot] = rows[row][slot].real();
+                realEnvironment[slot] = Value(variables[slot]);
+            }
+            double realExpected = Evaluator(expression).evaluate(
+                    realEnvironment.data()).real();
+            if (compiled.isValid())
+            {
+                double actual = compiled.evaluate(variables.data());
+                _result->check(SameReal(actual, realExpected),
+                        "CompiledExpression%s: '%s' row %d gives %.17g, "
+                        "not %.17g", compiled.isNative() ? " (native)" : "",
+                        _formula.c_str(), row, actual, realExpected);
+            }
+        }
+        delete bytecode;
+    }
+
+private:
+    TestResult* _result;
+    const std::string& _formula;
+
+    template<typename Evaluation>
+    void compare(const Scope& scope, const std::vector<Value>& row,
+            const Value& expected, const std::vector<Value>& expectedRow,
+            const char* name, Evaluation& evaluation)
+    {
+        std::vector<Value> environment = row;
+        Value actual = evaluation.evaluate(environment.data());
+        _result->check(SameValue(actual, expected)
+                && sameEnvironment(scope, environment, expectedRow),
+                "%s: '%s' gives %s, not %s", name, _formula.c_str(),
+                ValueString(actual).c_str(), ValueString(expected).c_str());
+    }
+};
+
+} /* anonymous namespace */
+
+int main()
+{
+    TestResult result("evaluators");
+    srand(1);
+    for (int i = 0; i < kFormulas; i++)
+    {
+        FormulaGenerator::Options options;
+        options.depth = 1 + i % 4;
+        options.width = 1 + i % 5;
+        options.identifierCount = kIdentifiers;
+        options.assignmentRatio = 0.2;
+        options.seed = i + 1;
+        std::string formula;
+        FormulaGenerator(options).generate(&formula);
+        FormulaTest(&result, formula).run();
+    }
+    return result.finish();
+}
@@ -0,0 +1,101 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Edits generated formulas with an IncrementalParser and compares every
+// result to a full parse of the edited text, diagnostics included. Edits
+// insert and remove operators, operands, parentheses and spaces at random
+// places, so they split and join tokens, change the operators around
+// reused chains and break the syntax.
+
+#include <cstdlib>
+#include <string>
+#include "generator.h"
+#include "incremental.h"
+#include "test.h"
+
+using namespace Doppio;
+
+namespace
+{
+
+const int kFormulas = 3000;
+const int kEdits = 40;
+
+const char* const kPieces[] =
+{
+    "(", ")", "+", "-", "*", "/", "%", "^", "!", ",", "=", ";", " ", " + ",
+    " * ", "x0", "y", "1", "23", "2.5", "1e5", "e", ".", "sin(", "max(",
+    "int "
+};
+
+std::string randomInsertion()
+{
+    std::string text;
+    int count = rand() % 3;
+    for (int i = 0; i < count; i++)
+    {
+        text += kPieces[rand() % (sizeof(kPieces) / sizeof(kPieces[0]))];
+    }
+    return text;
+}
+
+} /* anonymous namespace */
+
+int main()
+{
+    TestResult result("incremental");
+    srand(1);
+    for (int i = 0; i < kFormulas; i++)
+    {
+        FormulaGenerator::Options options;
+        options.depth = 1 + i % 4;
+        options.width = 1 + i % 8;
+        options.identifierCount = 4;
+        options.assignmentRatio = 0.2;
+        options.seed = i + 1;
+        std::string text;
+        FormulaGenerator(options).generate(&text);
+
+        IncrementalParser parser;
+        parser.parse(text.data(), text.size());
+        for (int edit = 0; edit < kEdits; edit++)
+        {
+            size_t offset = rand() % (text.size() + 1);
+            size_t removed = rand() % 4;
+            if (removed > text.size() - offset)
+            {
+                removed = text.size() - offset;
+            }
+            std::string inserted = randomInsertion();
+            std::string before = text;
+            text.replace(offset, removed, inserted);
+
+            std::string incremental = ParseString(parser.edit(offset,
+                    removed, inserted.data(), inserted.size()));
+            Zone zone;
+            Parser full(text.data(), text.size(), &zone);
+            std::string expected = ParseString(full.parse());
+            result.check(parser.text() == text && incremental == expected,
+                    "'%s' -> '%s' parses to\n  %s\nnot\n  %s",
+                    before.c_str(), text.c_str(), incremental.c_str(),
+                    expected.c_str());
+        }
+    }
+    return result.finish();
+}
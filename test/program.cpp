@@ -0,0 +1,184 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Parses a generated program with a ProgramParser, from memory, from a
+// MappedFile and from a stream read in small and large chunks, and with a
+// ParallelParser on one to four threads. All must find the same
+// statements at the same offsets with the same trees. Some statements are
+// empty or have unbalanced parentheses and other syntax errors, which
+// must stay within their statement.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "generator.h"
+#include "parallel.h"
+#include "program.h"
+#include "test.h"
+
+using namespace Doppio;
+
+namespace
+{
+
+// Enough statements for several batches of the ParallelParser.
+const int kStatements = 5000;
+
+const char* const kPath = "program_test.txt";
+
+struct ParsedStatement
+{
+    size_t offset;
+    std::string tree;
+};
+
+std::string statementString(ExpressionStatement* statement)
+{
+    Expression* expression = statement->expression();
+    return expression ? TreePrinter().print(expression) : "error";
+}
+
+std::string generateProgram()
+{
+    std::string program;
+    srand(1);
+    for (int i = 0; i < kStatements; i++)
+    {
+        FormulaGenerator::Options options;
+        options.depth = 1 + i % 4;
+        options.width = 1 + i % 5;
+        options.assignmentRatio = 0.2;
+        options.seed = i + 1;
+        std::string formula;
+        FormulaGenerator(options).generate(&formula);
+        switch (rand() % 16)
+        {
+        case 0:
+            formula.insert(rand() % (formula.size() + 1), "(");
+            break;
+        case 1:
+            formula.insert(rand() % (formula.size() + 1), ")");
+            break;
+        case 2:
+            formula.erase(rand() % formula.size(), 1);
+            break;
+        case 3:
+            formula = rand() % 2 ? "" : " \n";
+            break;
+        default:
+            break;
+        }
+        program += formula;
+        program += i % 7 == 0 ? ";\n" : "; ";
+    }
+    // a last statement without ';' and an unclosed group
+    program += "x0 + (x1";
+    return program;
+}
+
+void parseProgram(ProgramParser* parser,
+        std::vector<ParsedStatement>* statements)
+{
+    while (ExpressionStatement* statement = parser->parseStatement())
+    {
+        ParsedStatement parsed = { parser->statementOffset(),
+                statementString(statement) };
+        statements->push_back(parsed);
+    }
+}
+
+void compare(TestResult* result, const char* name,
+        const std::vector<ParsedStatement>& expected,
+        const std::vector<ParsedStatement>& actual)
+{
+    result->check(actual.size() == expected.size(),
+            "%s finds %zu statements, not %zu", name, actual.size(),
+            expected.size());
+    for (size_t i = 0; i < expected.size() && i < actual.size(); i++)
+    {
+        result->check(actual[i].offset == expected[i].offset
+                && actual[i].tree == expected[i].tree,
+                "%s: statement %zu at %zu is\n  %s\nnot at %zu\n  %s", name,
+                i, actual[i].offset, actual[i].tree.c_str(),
+                expected[i].offset, expected[i].tree.c_str());
+    }
+}
+
+} /* anonymous namespace */
+
+int main()
+{
+    TestResult result("program");
+    std::string program = generateProgram();
+
+    std::vector<ParsedStatement> expected;
+    ProgramParser memoryParser(program.data(), program.size());
+    parseProgram(&memoryParser, &expected);
+
+    FILE* file = fopen(kPath, "wb");
+    if (file == NULL
+            || fwrite(program.data(), 1, program.size(), file)
+                    != program.size())
+    {
+        fprintf(stderr, "program: cannot write %s\n", kPath);
+        return 1;
+    }
+    fclose(file);
+
+    MappedFile mapped(kPath);
+    if (mapped.isOpen())
+    {
+        std::vector<ParsedStatement> statements;
+        ProgramParser parser(mapped.data(), mapped.length());
+        parseProgram(&parser, &statements);
+        compare(&result, "mapped", expected, statements);
+    }
+
+    const size_t chunkSizes[] = { 7, 4096, ProgramParser::kDefaultChunkSize };
+    for (size_t i = 0; i < sizeof(chunkSizes) / sizeof(chunkSizes[0]); i++)
+    {
+        FILE* stream = fopen(kPath, "rb");
+        std::vector<ParsedStatement> statements;
+        ProgramParser parser(stream, chunkSizes[i]);
+        parseProgram(&parser, &statements);
+        fclose(stream);
+        char name[32];
+        snprintf(name, sizeof(name), "chunks of %zu", chunkSizes[i]);
+        compare(&result, name, expected, statements);
+    }
+    remove(kPath);
+
+    for (int threads = 1; threads <= 4; threads++)
+    {
+        ParallelParser parser(program.data(), program.size());
+        int count = parser.parse(threads);
+        std::vector<ParsedStatement> statements;
+        for (int i = 0; i < count; i++)
+        {
+            ParsedStatement parsed = { parser.statementOffset(i),
+                    statementString(parser.at(i)) };
+            statements.push_back(parsed);
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "%d threads", threads);
+        compare(&result, name, expected, statements);
+    }
+    return result.finish();
+}
@@ -0,0 +1,201 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef DOPPIO_TEST_H_
+#define DOPPIO_TEST_H_
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+#include "ast.h"
+#include "parser.h"
+
+namespace Doppio
+{
+
+// Counts the checks of a differential test and prints the first few
+// mismatches.
+class TestResult
+{
+public:
+    explicit TestResult(const char* name) :
+            _name(name), _checks(0), _failures(0)
+    {
+    }
+
+    void check(bool passed, const char* format, ...)
+    {
+        _checks++;
+        if (passed)
+        {
+            return;
+        }
+        if (_failures++ < kReportedFailures)
+        {
+            va_list arguments;
+            va_start(arguments, format);
+            fprintf(stderr, "%s: ", _name);
+            vfprintf(stderr, format, arguments);
+            fputc('\n', stderr);
+            va_end(arguments);
+        }
+    }
+
+    // Prints the totals and returns the exit status of the test.
+    int finish() const
+    {
+        printf("%s: %ld checks, %ld mismatches\n", _name, _checks,
+                _failures);
+        return _failures == 0 ? 0 : 1;
+    }
+
+private:
+    static const int kReportedFailures = 10;
+
+    const char* _name;
+    long _checks;
+    long _failures;
+};
+
+// Reals are the same if they are equal and have the same sign, or are
+// both NaN.
+inline bool SameReal(double a, double b)
+{
+    if (std::isnan(a) || std::isnan(b))
+    {
+        return std::isnan(a) && std::isnan(b);
+    }
+    return a == b && std::signbit(a) == std::signbit(b);
+}
+
+inline bool SameValue(const Value& a, const Value& b)
+{
+    if (a.isInteger() != b.isInteger())
+    {
+        return false;
+    }
+    return a.isInteger() ? a.integer() == b.integer() :
+            SameReal(a.real(), b.real());
+}
+
+inline std::string ValueString(const Value& value)
+{
+    char buffer[64];
+    if (value.isInteger())
+    {
+        snprintf(buffer, sizeof(buffer), "%ld", value.integer());
+    }
+    else
+    {
+        snprintf(buffer, sizeof(buffer), "%.17g", value.real());
+    }
+    return buffer;
+}
+
+// Prints a tree with every operation in parentheses, so that two parses
+// print the same exactly if their trees are the same.
+class TreePrinter: public AstVisitor<TreePrinter>
+{
+public:
+    std::string print(Expression* expression)
+    {
+        _text.clear();
+        visit(expression);
+        return _text;
+    }
+
+    void visitAssignmentExpression(AssignmentExpression* node)
+    {
+        _text += "(";
+        visit(node->target());
+        _text += " ";
+        _text += Token::String(node->operation());
+        _text += " ";
+        visit(node->value());
+        _text += ")";
+    }
+
+    void visitUnaryOperationExpression(UnaryOperationExpression* node)
+    {
+        _text += "(";
+        visit(node->expression());
+        _text += "!)";
+    }
+
+    void visitBinaryOperationExpression(BinaryOperationExpression* node)
+    {
+        _text += "(";
+        visit(node->left());
+        _text += " ";
+        _text += Token::String(node->operation());
+        _text += " ";
+        visit(node->right());
+        _text += ")";
+    }
+
+    void visitFunctionExpression(FunctionExpression* node)
+    {
+        visit(node->identifier());
+        _text += "(";
+        for (int i = 0; i < node->arguments().length(); i++)
+        {
+            _text += i > 0 ? ", " : "";
+            visit(node->arguments()[i]);
+        }
+        _text += ")";
+    }
+
+    void visitIdentifier(Identifier* node)
+    {
+        _text.append(node->name(), node->length());
+    }
+
+    void visitNumber(Number* node)
+    {
+        _text += ValueString(node->value());
+    }
+
+private:
+    std::string _text;
+};
+
+// Prints the tree of a parse, or its diagnostics if it has none.
+inline std::string ParseString(const ParseResult& result)
+{
+    if (result.expression != NULL)
+    {
+        return TreePrinter().print(result.expression);
+    }
+    std::string text = "error";
+    for (int i = 0; i < result.diagnosticCount; i++)
+    {
+        const Diagnostic& diagnostic = result.diagnostics[i];
+        char buffer[160];
+        snprintf(buffer, sizeof(buffer), " [%s at %zu-%zu, %llx]",
+                diagnostic.message, diagnostic.start, diagnostic.end,
+                (unsigned long long) diagnostic.expected);
+        text += buffer;
+    }
+    return text;
+}
+
+} /* Doppio namespace */
+
+#endif /* DOPPIO_TEST_H_ */